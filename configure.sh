@@ -39,7 +39,7 @@ elif [ $check = undefined ]
 then
   check=no
 fi
-CFLAGS="-std=c++11"
+CFLAGS="-std=c++11 -pthread"
 if [ $debug = yes ]
 then
   CFLAGS="$CFLAGS -g3 -Wall -Wextra"
@@ -91,6 +91,23 @@ EOF
     [ $? = 42 ] && CFLAGS="$CFLAGS -DHAVEUNLOCKEDIO"
   fi
   rm -f $tmp*
+cat >$tmp.c <<EOF
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+int main () {
+  struct io_uring_sqe sqe;
+  sqe.opcode = IORING_OP_OPENAT;
+  sqe.file_index = 1;
+  return sqe.opcode == IORING_OP_OPENAT && __NR_io_uring_setup ? 42 : 1;
+}
+EOF
+  if $CC $CFLAGS $tmp.c -o $tmp.exe 1>/dev/null 2>/dev/null
+  then
+    $tmp.exe 1>/dev/null 2>/dev/null
+    [ $? = 42 ] && CFLAGS="$CFLAGS -DHAVEIOURING"
+  fi
+  rm -f $tmp*
 fi
 AIGLIB="../aiger/aiger.o"
 
@@ -7,23 +7,58 @@
 */
 /*------------------------------------------------------------------------*/
 #include "aig.h"
+#include "async_writer.h"
+#include "cnf.h"
+#include "mmap_writer.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <map>
 /*------------------------------------------------------------------------*/
 // Global Variables
-unsigned idx;
+thread_local unsigned idx;
 
 /*------------------------------------------------------------------------*/
 // Local Variables
 
-aiger * model;   // /< aiger* object, used for storing the generated AIG graph
+// / aiger* object, used for storing the generated AIG graph
+thread_local aiger * model;
+
+// / Blocks freed by the aiger library, kept by size for the next model
+typedef std::map<size_t, std::vector<void *>> block_map;
+static thread_local block_map free_blocks;
+
+static unsigned memory_error = 41;
 
-static unsigned writing_error = 21;
+/*------------------------------------------------------------------------*/
+/**
+    Allocator of the aiger library. The library doubles its stacks, hence
+    successive models request the same few block sizes, which are served
+    from 'free_blocks' instead of 'malloc'.
+*/
+static void * cached_malloc(void *, size_t bytes) {
+  block_map::iterator it = free_blocks.find(bytes);
+  if (it != free_blocks.end() && !it->second.empty()) {
+    void * res = it->second.back();
+    it->second.pop_back();
+    return res;
+  }
+  void * res = malloc(bytes);
+  if (!res && bytes)
+    die(memory_error, "out of memory allocating %zu bytes", bytes);
+  return res;
+}
 
+/*------------------------------------------------------------------------*/
 
+static void cached_free(void *, void * ptr, size_t bytes) {
+  if (ptr) free_blocks[bytes].push_back(ptr);
+}
 
 /*------------------------------------------------------------------------*/
 void init_aig(int size) {
   assert(!model);
-  model = aiger_init();
+  model = aiger_init_mem(0, cached_malloc, cached_free);
   assert(model);
 
   insert_inputs(size);
@@ -33,6 +68,87 @@ void init_aig(int size) {
 void reset_aig() {
   assert(model);
   aiger_reset(model);
+  model = 0;
+}
+/*------------------------------------------------------------------------*/
+aiger * detach_aig() {
+  aiger * res = model;
+  model = 0;
+  return res;
+}
+/*------------------------------------------------------------------------*/
+void attach_aig(aiger * m) {
+  assert(!model);
+  model = m;
+}
+/*------------------------------------------------------------------------*/
+void release_aig_memory() {
+  assert(!model);
+  block_map::iterator it;
+  for (it = free_blocks.begin(); it != free_blocks.end(); ++it) {
+    for (size_t i = 0; i < it->second.size(); i++) free(it->second[i]);
+  }
+  free_blocks.clear();
+}
+/*------------------------------------------------------------------------*/
+/**
+    Adds the 32-bit word 'x' in little-endian byte order to 'hash'
+*/
+static uint64_t hash_word(uint64_t hash, unsigned x) {
+  char bytes[4];
+  for (unsigned i = 0; i < 4; i++) bytes[i] = (x >> (8 * i)) & 255;
+  return update_checksum(hash, bytes, 4);
+}
+/*------------------------------------------------------------------------*/
+uint64_t model_fingerprint() {
+  assert(model);
+  // gate defining each variable, 'num_ands' for inputs and the constant
+  std::vector<unsigned> gate(model->maxvar + 1, model->num_ands);
+  for (unsigned i = 0; i < model->num_ands; i++)
+    gate[aiger_lit2var(model->ands[i].lhs)] = i;
+
+  // canonical variables: inputs in order, then gates in post-order
+  std::vector<unsigned> canonical(model->maxvar + 1, 0);
+  for (unsigned i = 0; i < model->num_inputs; i++)
+    canonical[aiger_lit2var(model->inputs[i].lit)] = i + 1;
+  unsigned next = model->num_inputs + 1;
+
+  uint64_t res = hash_word(initial_checksum, model->num_inputs);
+  std::vector<unsigned> stack;
+  for (unsigned o = 0; o < model->num_outputs; o++) {
+    unsigned root = aiger_lit2var(model->outputs[o].lit);
+    if (!canonical[root] && gate[root] < model->num_ands)
+      stack.push_back(root);
+
+    while (!stack.empty()) {
+      unsigned var = stack.back();
+      const aiger_and & g = model->ands[gate[var]];
+      unsigned rhs[2] = { aiger_lit2var(g.rhs0), aiger_lit2var(g.rhs1) };
+      // the child with the smaller variable is visited first, as by
+      // 'aiger_reencode', hence equal reencoded models get equal numbers
+      unsigned larger = rhs[0] < rhs[1];
+      bool pushed = 0;
+      for (unsigned i = 0; i < 2; i++) {
+        unsigned child = rhs[i ? !larger : larger];
+        if (canonical[child] || gate[child] == model->num_ands) continue;
+        stack.push_back(child);
+        pushed = 1;
+      }
+      if (pushed) continue;
+
+      stack.pop_back();
+      if (canonical[var]) continue;  // pushed twice
+      canonical[var] = next++;
+      unsigned lit0 = 2 * canonical[rhs[0]] + aiger_sign(g.rhs0);
+      unsigned lit1 = 2 * canonical[rhs[1]] + aiger_sign(g.rhs1);
+      if (lit0 < lit1) std::swap(lit0, lit1);
+      res = hash_word(hash_word(res, lit0), lit1);
+    }
+
+    unsigned lit = model->outputs[o].lit;
+    res = hash_word(res, 2 * canonical[aiger_lit2var(lit)] + aiger_sign(lit));
+  }
+  return res;
 }
 /*------------------------------------------------------------------------*/
 void insert_inputs(int size){
@@ -57,25 +173,198 @@ void insert_inputs(int size){
 
 /*=========================================================================*/
 
-void write_fuzzed_model(const char * output_name, bool reencode) {
-  if(reencode) {
+static void write_aiger_header(sink * s, const char * format_string) {
+  sink_put_s(s, format_string);
+  unsigned header[5] = { model->maxvar, model->num_inputs, 0,
+                         model->num_outputs, model->num_ands };
+  for (unsigned i = 0; i < 5; i++) {
+    sink_put_ch(s, ' ');
+    sink_put_u(s, header[i]);
+  }
+  sink_put_ch(s, '\n');
+
+  if (s->format == aag_format) {
+    for (unsigned i = 0; i < model->num_inputs; i++) {
+      sink_put_u(s, model->inputs[i].lit);
+      sink_put_ch(s, '\n');
+    }
+  }
+  for (unsigned i = 0; i < model->num_outputs; i++) {
+    sink_put_u(s, model->outputs[i].lit);
+    sink_put_ch(s, '\n');
+  }
+}
+
+/*------------------------------------------------------------------------*/
+
+static void write_aiger_symbols(sink * s, const char * type,
+                                aiger_symbol * symbols, unsigned size) {
+  for (unsigned i = 0; i < size; i++) {
+    if (!symbols[i].name) continue;
+    sink_put_s(s, type);
+    sink_put_u(s, i);
+    sink_put_ch(s, ' ');
+    sink_put_s(s, symbols[i].name);
+    sink_put_ch(s, '\n');
+  }
+}
+
+/*------------------------------------------------------------------------*/
+
+void write_model_header(sink * s, unsigned clauses) {
+  switch (s->format) {
+    case aig_format: write_aiger_header(s, "aig"); break;
+    case aag_format: write_aiger_header(s, "aag"); break;
+    case cnf_format: write_cnf_header(s, clauses); break;
+  }
+}
+
+/*------------------------------------------------------------------------*/
+
+static void write_gate(sink * s, unsigned i) {
+  aiger_and * gate = model->ands + i;
+  switch (s->format) {
+    case aig_format:
+      sink_put_delta(s, gate->lhs - gate->rhs0);
+      sink_put_delta(s, gate->rhs0 - gate->rhs1);
+      break;
+    case aag_format:
+      sink_put_u(s, gate->lhs);
+      sink_put_ch(s, ' ');
+      sink_put_u(s, gate->rhs0);
+      sink_put_ch(s, ' ');
+      sink_put_u(s, gate->rhs1);
+      sink_put_ch(s, '\n');
+      break;
+    case cnf_format:
+      write_cnf_gate(s, i);
+      break;
+  }
+}
+
+/*------------------------------------------------------------------------*/
+
+void write_model_trailer(sink * s) {
+  if (s->format == cnf_format) return;
+  write_aiger_symbols(s, "i", model->inputs, model->num_inputs);
+  write_aiger_symbols(s, "o", model->outputs, model->num_outputs);
+}
+
+/*------------------------------------------------------------------------*/
+
+/**
+    Writes the 'aiger* model' to the sinks 'pass' in one pass over the AND
+    gates
+*/
+static void write_model_pass(const std::vector<sink *> & pass,
+                             unsigned clauses) {
+  for (size_t j = 0; j < pass.size(); j++)
+    write_model_header(pass[j], clauses);
+
+  for (unsigned i = 0; i < model->num_ands; i++) {
+    for (size_t j = 0; j < pass.size(); j++) write_gate(pass[j], i);
+  }
+
+  for (size_t j = 0; j < pass.size(); j++) write_model_trailer(pass[j]);
+}
+
+/*------------------------------------------------------------------------*/
+
+uint64_t write_fuzzed_model(const output_targets & targets,
+                            bool reencode, bool compact_xor) {
+  std::vector<sink> sinks;
+  std::vector<const char *> mapped;
+  bool binary = targets.arch, cnf = 0, archived = 0;
+  for (size_t j = 0; j < targets.names.size(); j++) {
+    const char * name = targets.names[j];
+    output_format format = output_format_of(name);
+    if (format == aig_format) binary = 1;
+    if (format == cnf_format) cnf = 1;
+
+    if (targets.mapped && format == aig_format) {
+      mapped.push_back(name);
+      continue;
+    }
+    sinks.push_back(sink());
+    if (targets.async) init_memory_sink(&sinks.back(), name, format);
+    else open_sink(&sinks.back(), name);
+    sinks.back().hashed = targets.records;
+  }
+  size_t files = sinks.size();
+  if (targets.archive_sink) {
+    sinks.push_back(sink());
+    init_memory_sink(&sinks.back(), targets.arch->name, aig_format);
+  } else if (targets.arch) {
+    sinks.push_back(sink());
+    if (begin_archive_entry(targets.arch, &sinks.back(), targets.key)) {
+      sinks.back().hashed = targets.records;
+      archived = 1;
+    } else {
+      sinks.pop_back();
+      msg(1,"  Skipped entry already contained in archive: '%s'",
+        targets.arch->name);
+    }
+  }
+
+  if (reencode) {
     aiger_reencode(model);
     msg(2,"  Reencoded AIG");
   }
 
-  FILE * output_file;
-  if (!(output_file = fopen(output_name, "w")))
-      die(writing_error, "can not write output to '%s'", output_name);
+  unsigned clauses = cnf ? prepare_cnf(compact_xor) : 0;
 
-  if (!aiger_write_to_file(model, aiger_binary_mode, output_file))
-        die(writing_error, "failed to write rewritten aig to '%s'", output_name);
+  // the binary format requires a reencoded model (as in 'aiger_write'),
+  // without '-r' the other formats are written before it is reencoded, so
+  // adding a binary target does not change them
+  std::vector<sink *> first, second;
+  for (size_t j = 0; j < sinks.size(); j++) {
+    if (!reencode && sinks[j].format == aig_format) second.push_back(&sinks[j]);
+    else first.push_back(&sinks[j]);
+  }
+  write_model_pass(first, clauses);
+  if (binary && !reencode) {
+    aiger_reencode(model);
+    write_model_pass(second, clauses);
+  }
 
-  msg(1,"Output");
-  msg(1,"==========================================================");
-  msg(1,"  Printed fuzzed AIG to: '%s'", output_name);
-  msg(1,"");
+  uint64_t res = 0;
+  for (size_t j = 0; j < sinks.size(); j++)
+    res += sinks[j].bytes + (sinks[j].cursor - sinks[j].start);
 
-  fclose(output_file);
+  if (targets.records) {
+    for (size_t j = 0; j < sinks.size(); j++) {
+      finish_checksum(&sinks[j]);
+      file_record record;
+      record.name = sinks[j].name;
+      record.bytes = sinks[j].bytes;
+      record.checksum = sinks[j].checksum;
+      targets.records->push_back(record);
+    }
+  }
 
+  for (size_t j = 0; j < mapped.size(); j++) {
+    file_record record;
+    res += write_mapped_aig(mapped[j], targets.mapped_threads,
+                            targets.records ? &record : 0);
+    if (targets.records) targets.records->push_back(record);
+    msg(1,"  Printed fuzzed AIG to: '%s'", mapped[j]);
+  }
+  for (size_t j = 0; j < files; j++) {
+    if (targets.async) {
+      size_t size;
+      char * data = take_sink_buffer(&sinks[j], &size);
+      async_write_file(sinks[j].name, data, size);
+    } else {
+      close_sink(&sinks[j]);
+    }
+    msg(1,"  Printed fuzzed AIG to: '%s'", sinks[j].name);
+  }
+  if (targets.archive_sink) {
+    *targets.archive_sink = sinks.back();
+  } else if (archived) {
+    end_archive_entry(targets.arch, &sinks.back(), targets.key);
+    msg(1,"  Appended fuzzed AIG to archive: '%s'", targets.arch->name);
+  }
+  return res;
 }
 /*------------------------------------------------------------------------*/
@@ -11,6 +11,9 @@
 /*------------------------------------------------------------------------*/
 #include <assert.h>
 
+#include <vector>
+
+#include "archive.h"
 #include "signal_statistics.h"
 
 extern "C" {
@@ -18,9 +21,11 @@ extern "C" {
 }
 /*------------------------------------------------------------------------*/
 
-extern unsigned idx; // /< counts idx
+// generator state is local to each thread of a parallel batch
+
+extern thread_local unsigned idx; // /< counts idx
 
-extern aiger * model;
+extern thread_local aiger * model;
 /*------------------------------------------------------------------------*/
 
 /**
@@ -31,9 +36,40 @@ void init_aig(int size);
 /*------------------------------------------------------------------------*/
 
 /**
-    Resets the 'aiger* model', which is local to aig.cpp
+    Resets the 'aiger* model', which is local to aig.cpp. Its memory is
+    kept for the next model.
 */
 void reset_aig();
+
+/**
+    Hands the 'aiger* model' of this thread over to another thread
+
+    @return the model, 'model' is reset to 0
+*/
+aiger * detach_aig();
+
+/**
+    Makes 'm' the 'aiger* model' of this thread. Models have to be reset by
+    the thread which generated them, since their memory is kept per thread.
+
+    @param m model detached by 'detach_aig'
+*/
+void attach_aig(aiger * m);
+
+/**
+    Deallocates the memory kept for the next model
+*/
+void release_aig_memory();
+
+/**
+    Fingerprint of the structure of the 'aiger* model': a hash over its
+    gates numbered in post-order from the outputs in the same order as by
+    'aiger_reencode', hence models written to the same binary AIGER file
+    get the same fingerprint. The model itself is not changed.
+
+    @return uint64_t
+*/
+uint64_t model_fingerprint();
 /*------------------------------------------------------------------------*/
 
 /**
@@ -43,12 +79,55 @@ void insert_inputs(int size);
 /*------------------------------------------------------------------------*/
 
 /**
-    Writes the 'aiger* model' to the provided file.
+    Writes the header of the 'aiger* model' in the format of 's', for CNF
+    this is the variable map and the DIMACS header
+
+    @param s sink
+    @param clauses number of clauses of CNF output
+*/
+void write_model_header(sink * s, unsigned clauses);
+
+/**
+    Writes the symbol table of the 'aiger* model' in the format of 's'
+
+    @param s sink
+*/
+void write_model_trailer(sink * s);
+/*------------------------------------------------------------------------*/
+
+/**
+    Output targets of one generated instance
+*/
+struct output_targets {
+  std::vector<const char *> names;  // /< output files
+  archive * arch;                   // /< archive to append to, or 0
+  archive_key key;                  // /< key of the instance in 'arch'
+  sink * archive_sink;              // /< receives the entry for 'arch' as
+                                    //    memory sink instead, or 0
+  std::vector<file_record> * records;  // /< receives size and checksum
+                                       //    of files and entry, or 0
+  bool async;                       // /< files are written by 'async_writer'
+  bool mapped;                      // /< binary files are written by
+                                    //    'write_mapped_aig'
+  unsigned mapped_threads;          // /< threads encoding a mapped file
+};
+
+/**
+    Writes the 'aiger* model' to all provided targets in one pass over the
+    AND gates. Each file gets its own buffered sink, its format is selected
+    by the suffix of its name. The archive entry is written in binary AIGER.
+    Binary AIGER requires a reencoded model, without 'reencode' the other
+    formats are written first and the binary targets in a second pass after
+    reencoding, so each file does not depend on the other targets.
 
-    @param file output file
+    @param targets output files and archive
+    @param reencode reencodes the model before writing
+    @param compact_xor compact XOR encoding for CNF output
 
+    @return number of bytes written to files and archive
 */
-void write_fuzzed_model(const char * output_name, bool reencode);
+uint64_t write_fuzzed_model(const output_targets & targets,
+                            bool reencode, bool compact_xor);
 
 
 #endif  // AIGENFUZZER_SRC_AIG_H_
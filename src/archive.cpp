@@ -0,0 +1,297 @@
+/*------------------------------------------------------------------------*/
+/*! \file archive.cpp
+    \brief contains functions to pack many generated AIGs into one file
+
+  Part of MultAIGenFuzzer: Generation-Based AIG Fuzzer for Multipliers
+  Copyright(C) 2022 Daniela Kaufmann, Johannes Kepler University Linz
+*/
+/*------------------------------------------------------------------------*/
+#include "archive.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+/*------------------------------------------------------------------------*/
+// Local Variables
+
+static const char archive_magic[8] = {'M', 'A', 'F', 'A', 'R', 'C', 'H', '1'};
+static const char index_magic[8]   = {'M', 'A', 'F', 'I', 'N', 'D', 'E', 'X'};
+
+static const uint64_t archive_alignment = 8;
+
+static unsigned archive_error = 22;
+/*------------------------------------------------------------------------*/
+
+bool archive_entry_less::operator()(const archive_entry & a,
+                                    const archive_entry & b) const {
+  if (a.key.width != b.key.width) return a.key.width < b.key.width;
+  if (a.key.seed != b.key.seed) return a.key.seed < b.key.seed;
+  return a.key.options < b.key.options;
+}
+
+/*------------------------------------------------------------------------*/
+
+static void write_bytes(archive * arch, const void * data, size_t bytes) {
+  if (fwrite(data, 1, bytes, arch->file) != bytes)
+    die(archive_error, "failed to write archive '%s'", arch->name);
+}
+
+/*------------------------------------------------------------------------*/
+
+static void seek_aligned_end(archive * arch) {
+  static const char zeros[archive_alignment] = {0};
+  if (fseeko(arch->file, arch->end, SEEK_SET))
+    die(archive_error, "failed to seek in archive '%s'", arch->name);
+  uint64_t pad = (archive_alignment - arch->end % archive_alignment)
+                 % archive_alignment;
+  write_bytes(arch, zeros, pad);
+  arch->end += pad;
+}
+
+/*------------------------------------------------------------------------*/
+
+/**
+    Checks the magic number of the archive given as 'size' bytes at 'data'
+    and returns its last valid footer. Bytes following it were written by
+    a run that did not close the archive.
+*/
+static const archive_footer * check_archive(
+  const char * name, const char * data, uint64_t size) {
+
+  if (size < sizeof archive_magic + sizeof(archive_footer) ||
+      memcmp(data, archive_magic, sizeof archive_magic))
+    die(archive_error, "'%s' is not an archive", name);
+
+  // footers start at aligned offsets right after their index
+  uint64_t pos = size - sizeof(archive_footer);
+  pos -= pos % archive_alignment;
+  for (; pos >= sizeof archive_magic; pos -= archive_alignment) {
+    const archive_footer * footer =
+      reinterpret_cast<const archive_footer *>(data + pos);
+    if (!memcmp(footer->magic, index_magic, sizeof index_magic) &&
+        footer->index_offset >= sizeof archive_magic &&
+        footer->index_offset <= pos &&
+        (pos - footer->index_offset) % sizeof(archive_entry) == 0 &&
+        (pos - footer->index_offset) / sizeof(archive_entry) ==
+        footer->entries)
+      return footer;
+  }
+  die(archive_error, "index of archive '%s' is corrupted", name);
+  return 0;
+}
+
+/*------------------------------------------------------------------------*/
+
+/**
+    Maps the archive 'name' read-only into memory
+
+    @param name name of archive file
+    @param size set to the size of the archive
+
+    @return start of mapping
+*/
+static const char * map_archive(const char * name, uint64_t * size) {
+  int fd = open(name, O_RDONLY);
+  if (fd < 0) die(archive_error, "can not read archive '%s'", name);
+
+  struct stat st;
+  if (fstat(fd, &st)) die(archive_error, "can not read archive '%s'", name);
+  *size = st.st_size;
+
+  void * data = mmap(0, *size ? *size : 1, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (data == MAP_FAILED)
+    die(archive_error, "can not map archive '%s'", name);
+  close(fd);
+
+  return static_cast<const char *>(data);
+}
+
+/*------------------------------------------------------------------------*/
+
+/**
+    Writes the index and the footer at the aligned end of the data and
+    syncs the file, the footer only after the index
+*/
+static void write_index(archive * arch) {
+  seek_aligned_end(arch);
+
+  archive_footer footer;
+  footer.index_offset = arch->end;
+  footer.entries = arch->index.size();
+  memcpy(footer.magic, index_magic, sizeof index_magic);
+
+  for (auto it = arch->index.begin(); it != arch->index.end(); ++it)
+    write_bytes(arch, &*it, sizeof *it);
+  if (fflush(arch->file) || fsync(fileno(arch->file)))
+    die(archive_error, "failed to write archive '%s'", arch->name);
+  write_bytes(arch, &footer, sizeof footer);
+  if (fflush(arch->file) || fsync(fileno(arch->file)))
+    die(archive_error, "failed to write archive '%s'", arch->name);
+
+  arch->end = ftello(arch->file);
+}
+
+/*------------------------------------------------------------------------*/
+
+void open_archive(archive * arch, const char * name) {
+  arch->name = name;
+  arch->index.clear();
+
+  if (access(name, F_OK)) {
+    if (!(arch->file = fopen(name, "w+b")))
+      die(archive_error, "can not write archive '%s'", name);
+    write_bytes(arch, archive_magic, sizeof archive_magic);
+    arch->end = sizeof archive_magic;
+    // an empty index keeps the archive valid until 'close_archive'
+    write_index(arch);
+    msg(2, "  Created archive '%s'", name);
+    return;
+  }
+
+  uint64_t size;
+  const char * data = map_archive(name, &size);
+  const archive_footer * footer = check_archive(name, data, size);
+  const archive_entry * entries =
+    reinterpret_cast<const archive_entry *>(data + footer->index_offset);
+  arch->index.insert(entries, entries + footer->entries);
+  arch->end = footer->index_offset + footer->entries * sizeof(archive_entry)
+              + sizeof(archive_footer);
+  munmap(const_cast<char *>(data), size);
+
+  // new entries follow the old footer, which stays valid until the new
+  // index is written by 'close_archive'
+  if (!(arch->file = fopen(name, "r+b")))
+    die(archive_error, "can not write archive '%s'", name);
+  if (arch->end < size) {
+    if (ftruncate(fileno(arch->file), arch->end))
+      die(archive_error, "failed to truncate archive '%s'", name);
+    msg(1, "  Dropped %llu bytes of an unfinished run from archive '%s'",
+      (unsigned long long) (size - arch->end), name);
+  }
+  msg(2, "  Opened archive '%s' with %zu entries", name, arch->index.size());
+}
+
+/*------------------------------------------------------------------------*/
+
+bool archive_contains(const archive * arch, const archive_key & key) {
+  archive_entry entry;
+  entry.key = key;
+  return arch->index.count(entry);
+}
+
+/*------------------------------------------------------------------------*/
+
+bool begin_archive_entry(archive * arch, sink * s, const archive_key & key) {
+  if (archive_contains(arch, key)) return 0;
+  seek_aligned_end(arch);
+  init_sink(s, arch->file, arch->name, aig_format);
+  return 1;
+}
+
+/*------------------------------------------------------------------------*/
+
+void end_archive_entry(archive * arch, sink * s, const archive_key & key) {
+  release_sink(s);
+
+  archive_entry entry;
+  entry.key = key;
+  entry.offset = arch->end;
+  arch->end = ftello(arch->file);
+  entry.length = arch->end - entry.offset;
+  arch->index.insert(entry);
+}
+
+/*------------------------------------------------------------------------*/
+
+bool append_archive_entry(archive * arch, const char * data, size_t size,
+                          const archive_key & key) {
+  if (archive_contains(arch, key)) return 0;
+  seek_aligned_end(arch);
+  write_bytes(arch, data, size);
+
+  archive_entry entry;
+  entry.key = key;
+  entry.offset = arch->end;
+  entry.length = size;
+  arch->end += size;
+  arch->index.insert(entry);
+  return 1;
+}
+
+/*------------------------------------------------------------------------*/
+
+void close_archive(archive * arch) {
+  write_index(arch);
+  if (fclose(arch->file))
+    die(archive_error, "failed to close archive '%s'", arch->name);
+  arch->file = 0;
+
+  msg(1, "  Archive '%s' contains %zu entries", arch->name,
+    arch->index.size());
+}
+
+/*------------------------------------------------------------------------*/
+
+void list_archive(const char * name) {
+  uint64_t size;
+  const char * data = map_archive(name, &size);
+  const archive_footer * footer = check_archive(name, data, size);
+  const archive_entry * entries =
+    reinterpret_cast<const archive_entry *>(data + footer->index_offset);
+
+  msg(1, "Archive '%s'", name);
+  msg(1, "==========================================================");
+  msg(1, "  %8s %20s %8s %12s %12s", "width", "seed", "options",
+    "offset", "length");
+  for (uint64_t i = 0; i < footer->entries; i++) {
+    const archive_entry & e = entries[i];
+    msg(1, "  %8u %20llu %8u %12llu %12llu", e.key.width,
+      (unsigned long long) e.key.seed, e.key.options,
+      (unsigned long long) e.offset, (unsigned long long) e.length);
+  }
+  msg(1, "  %llu entries", (unsigned long long) footer->entries);
+
+  munmap(const_cast<char *>(data), size);
+}
+
+/*------------------------------------------------------------------------*/
+
+void extract_from_archive(const char * name, const archive_key & key,
+                          const char * output_name) {
+  uint64_t size;
+  const char * data = map_archive(name, &size);
+  const archive_footer * footer = check_archive(name, data, size);
+  const archive_entry * begin =
+    reinterpret_cast<const archive_entry *>(data + footer->index_offset);
+  const archive_entry * end = begin + footer->entries;
+
+  archive_entry entry;
+  entry.key = key;
+  const archive_entry * found =
+    std::lower_bound(begin, end, entry, archive_entry_less());
+  if (found == end || archive_entry_less()(entry, *found))
+    die(archive_error, "no entry of width %u, seed %llu and options %u "
+      "in archive '%s'", key.width, (unsigned long long) key.seed,
+      key.options, name);
+  if (found->offset + found->length > footer->index_offset)
+    die(archive_error, "index of archive '%s' is corrupted", name);
+
+  FILE * output_file;
+  if (!(output_file = fopen(output_name, "w")))
+    die(archive_error, "can not write output to '%s'", output_name);
+  uint64_t length = found->length;
+  if (fwrite(data + found->offset, 1, length, output_file) != length ||
+      fclose(output_file))
+    die(archive_error, "failed to write output to '%s'", output_name);
+
+  munmap(const_cast<char *>(data), size);
+
+  msg(1, "  Extracted %llu bytes to: '%s'",
+    (unsigned long long) length, output_name);
+}
+/*------------------------------------------------------------------------*/
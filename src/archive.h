@@ -0,0 +1,172 @@
+/*------------------------------------------------------------------------*/
+/*! \file archive.h
+    \brief contains functions to pack many generated AIGs into one file
+
+  The archive starts with the 8 byte magic 'MAFARCH1', followed by the
+  binary AIGER files of the instances, each starting at an 8 byte aligned
+  offset. The index is stored at the end of the file as an array of
+  'archive_entry' records sorted by key, followed by an 'archive_footer'.
+  All numbers are stored in host byte order.
+
+  A harness can mmap the archive, read the footer from the last bytes,
+  binary search the index and slice out an instance without copying.
+
+  New entries are appended after the footer of an existing archive, and
+  the new index and footer follow them when the archive is closed. The
+  old index stays in the file unused. If the run stops before, readers
+  use the last valid footer and the next run drops the bytes after it.
+
+  Part of MultAIGenFuzzer: Generation-Based AIG Fuzzer for Multipliers
+  Copyright(C) 2022 Daniela Kaufmann, Johannes Kepler University Linz
+*/
+/*------------------------------------------------------------------------*/
+#ifndef AIGENFUZZER_SRC_ARCHIVE_H_
+#define AIGENFUZZER_SRC_ARCHIVE_H_
+/*------------------------------------------------------------------------*/
+#include <stdint.h>
+
+#include <set>
+
+#include "writer.h"
+/*------------------------------------------------------------------------*/
+
+/**
+    Option bits stored in the key of an archive entry
+*/
+enum archive_options {
+  archive_no_cla    = 1,  // /< generated with '-cl'
+  archive_reencoded = 2,  // /< generated with '-r'
+  archive_miter     = 4,  // /< generated with '--miter'
+  archive_fuzzed_miter = 8  // /< generated with '--miter-seed', the seed
+                            //    of the second multiplier is stored in
+                            //    the upper 32 bits of the seed
+};
+
+/**
+    Identifies an instance in the archive
+*/
+struct archive_key {
+  uint32_t width;    // /< input bit-width
+  uint32_t options;  // /< 'archive_options' bits
+  uint64_t seed;     // /< seed of the instance
+};
+
+/**
+    Index record of the archive, 32 bytes
+*/
+struct archive_entry {
+  archive_key key;   // /< key of the instance
+  uint64_t offset;   // /< start of the instance in the archive
+  uint64_t length;   // /< number of bytes of the instance
+};
+
+/**
+    Orders index records by width, seed and options
+*/
+struct archive_entry_less {
+  bool operator()(const archive_entry & a, const archive_entry & b) const;
+};
+
+/**
+    Last 24 bytes of the archive
+*/
+struct archive_footer {
+  uint64_t index_offset;  // /< start of the index
+  uint64_t entries;       // /< number of index records
+  char magic[8];          // /< 'MAFINDEX'
+};
+
+/**
+    Archive opened for appending
+*/
+struct archive {
+  const char * name;                 // /< name of archive file
+  FILE * file;                       // /< file being written
+  uint64_t end;                      // /< end of the instance data
+  std::set<archive_entry, archive_entry_less> index;  // /< sorted index
+};
+/*------------------------------------------------------------------------*/
+
+/**
+    Opens the archive 'name' for appending, creates it if it does not exist.
+    The index of an existing archive is loaded into memory, its data and
+    footer are not changed.
+
+    @param arch archive
+    @param name name of archive file
+*/
+void open_archive(archive * arch, const char * name);
+
+/**
+    Checks whether the archive already contains an entry with 'key'
+
+    @param arch archive
+    @param key key of instance
+
+    @return true if found
+*/
+bool archive_contains(const archive * arch, const archive_key & key);
+
+/**
+    Attaches the sink 's' to the archive, positioned at the next entry,
+    unless the archive already contains an entry with 'key'
+
+    @param arch archive
+    @param s sink
+    @param key key of instance
+
+    @return false if 'key' is contained and 's' is not attached
+*/
+bool begin_archive_entry(archive * arch, sink * s, const archive_key & key);
+
+/**
+    Flushes 's' and records the written bytes in the index under 'key'
+
+    @param arch archive
+    @param s sink
+    @param key key of instance
+*/
+void end_archive_entry(archive * arch, sink * s, const archive_key & key);
+
+/**
+    Appends the entry given as 'size' bytes at 'data' under 'key', unless
+    the archive already contains an entry with 'key'
+
+    @param arch archive
+    @param data binary AIGER of the instance
+    @param size number of bytes
+    @param key key of instance
+
+    @return false if 'key' is contained and nothing is written
+*/
+bool append_archive_entry(archive * arch, const char * data, size_t size,
+                          const archive_key & key);
+
+/**
+    Writes the sorted index of all entries and the footer after the new
+    entries
+
+    @param arch archive
+*/
+void close_archive(archive * arch);
+/*------------------------------------------------------------------------*/
+
+/**
+    Prints the index of the archive 'name' to stdout
+
+    @param name name of archive file
+*/
+void list_archive(const char * name);
+
+/**
+    Copies the entry with 'key' of the archive 'name' to 'output_name'.
+    Dies if there is no such entry.
+
+    @param name name of archive file
+    @param key key of instance
+    @param output_name name of output file
+*/
+void extract_from_archive(const char * name, const archive_key & key,
+                          const char * output_name);
+
+#endif  // AIGENFUZZER_SRC_ARCHIVE_H_
@@ -0,0 +1,368 @@
+/*------------------------------------------------------------------------*/
+/*! \file async_writer.cpp
+    \brief contains the asynchronous output backend based on io_uring
+
+  Part of MultAIGenFuzzer: Generation-Based AIG Fuzzer for Multipliers
+  Copyright(C) 2022 Daniela Kaufmann, Johannes Kepler University Linz
+*/
+/*------------------------------------------------------------------------*/
+#include "async_writer.h"
+
+#include <stdint.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#ifdef HAVEIOURING
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+/*------------------------------------------------------------------------*/
+// Local Variables
+
+static unsigned writing_error = 21;
+
+static bool use_ring;  // /< io_uring is set up and used
+
+static std::mutex ring_mutex;  // /< serializes the threads of a batch
+/*------------------------------------------------------------------------*/
+
+static void write_file_sync(const char * name, const char * data,
+                            size_t size) {
+  FILE * file;
+  if (!(file = fopen(name, "w")))
+    die(writing_error, "can not write output to '%s'", name);
+  if (fwrite(data, 1, size, file) != size || fclose(file))
+    die(writing_error, "failed to write output to '%s'", name);
+}
+
+/*------------------------------------------------------------------------*/
+#ifdef HAVEIOURING
+
+static const unsigned ring_entries = 256;
+static const unsigned file_slots = 64;          // /< fixed file table size
+static const size_t max_write_chunk = 1 << 30;  // /< bytes per write request
+
+/**
+    File in flight, occupies one slot of the fixed file table
+*/
+struct write_job {
+  std::string name;   // /< name of output file
+  char * data;        // /< content of the file
+  size_t size;        // /< number of bytes
+  unsigned pending;   // /< number of outstanding completions
+  bool failed;        // /< one of the requests failed
+};
+
+static int ring_fd = -1;
+
+static void * sq_ring;
+static void * cq_ring;
+static size_t sq_ring_size, cq_ring_size, sqes_size;
+
+static unsigned * sq_head, * sq_tail, * sq_mask, * sq_array, sq_entries;
+static unsigned * cq_head, * cq_tail, * cq_mask;
+static io_uring_sqe * sqes;
+static io_uring_cqe * cqes;
+
+static unsigned to_submit;               // /< queued but not submitted
+static std::vector<write_job> jobs;      // /< indexed by file slot
+static std::vector<unsigned> free_slots;
+static size_t in_flight, in_flight_limit;
+/*------------------------------------------------------------------------*/
+
+static int sys_io_uring_setup(unsigned entries, io_uring_params * p) {
+  return syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int sys_io_uring_enter(unsigned submit, unsigned min_complete,
+                              unsigned flags) {
+  return syscall(__NR_io_uring_enter, ring_fd, submit, min_complete, flags,
+                 NULL, 0);
+}
+
+static int sys_io_uring_register(unsigned opcode, void * arg, unsigned n) {
+  return syscall(__NR_io_uring_register, ring_fd, opcode, arg, n);
+}
+
+/*------------------------------------------------------------------------*/
+
+static void unmap_ring() {
+  if (sqes) munmap(sqes, sqes_size);
+  if (cq_ring && cq_ring != sq_ring) munmap(cq_ring, cq_ring_size);
+  if (sq_ring) munmap(sq_ring, sq_ring_size);
+  sqes = 0;
+  sq_ring = cq_ring = 0;
+  close(ring_fd);
+  ring_fd = -1;
+}
+
+/*------------------------------------------------------------------------*/
+
+static bool setup_ring() {
+  io_uring_params p;
+  memset(&p, 0, sizeof p);
+  if ((ring_fd = sys_io_uring_setup(ring_entries, &p)) < 0) return 0;
+
+  sq_ring_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+  cq_ring_size = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+  bool single_mmap = p.features & IORING_FEAT_SINGLE_MMAP;
+  if (single_mmap) {
+    if (cq_ring_size > sq_ring_size) sq_ring_size = cq_ring_size;
+    cq_ring_size = sq_ring_size;
+  }
+
+  sq_ring = mmap(0, sq_ring_size, PROT_READ | PROT_WRITE,
+                 MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQ_RING);
+  if (sq_ring == MAP_FAILED) {
+    sq_ring = 0;
+    unmap_ring();
+    return 0;
+  }
+  if (single_mmap) cq_ring = sq_ring;
+  else cq_ring = mmap(0, cq_ring_size, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_CQ_RING);
+  if (cq_ring == MAP_FAILED) {
+    cq_ring = 0;
+    unmap_ring();
+    return 0;
+  }
+  sqes_size = p.sq_entries * sizeof(io_uring_sqe);
+  void * res = mmap(0, sqes_size, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQES);
+  if (res == MAP_FAILED) {
+    unmap_ring();
+    return 0;
+  }
+  sqes = static_cast<io_uring_sqe *>(res);
+
+  char * sq = static_cast<char *>(sq_ring);
+  sq_head  = reinterpret_cast<unsigned *>(sq + p.sq_off.head);
+  sq_tail  = reinterpret_cast<unsigned *>(sq + p.sq_off.tail);
+  sq_mask  = reinterpret_cast<unsigned *>(sq + p.sq_off.ring_mask);
+  sq_array = reinterpret_cast<unsigned *>(sq + p.sq_off.array);
+  sq_entries = p.sq_entries;
+
+  char * cq = static_cast<char *>(cq_ring);
+  cq_head = reinterpret_cast<unsigned *>(cq + p.cq_off.head);
+  cq_tail = reinterpret_cast<unsigned *>(cq + p.cq_off.tail);
+  cq_mask = reinterpret_cast<unsigned *>(cq + p.cq_off.ring_mask);
+  cqes = reinterpret_cast<io_uring_cqe *>(cq + p.cq_off.cqes);
+
+  // sparse fixed file table, filled by 'openat' requests
+  std::vector<int> fds(file_slots, -1);
+  if (sys_io_uring_register(IORING_REGISTER_FILES, fds.data(),
+                            file_slots) < 0) {
+    unmap_ring();
+    return 0;
+  }
+  return 1;
+}
+
+/*------------------------------------------------------------------------*/
+
+static void submit() {
+  while (to_submit) {
+    int res = sys_io_uring_enter(to_submit, 0, 0);
+    if (res < 0) {
+      if (errno == EINTR || errno == EAGAIN) continue;
+      die(writing_error, "failed to submit to io_uring");
+    }
+    to_submit -= res;
+  }
+}
+
+/*------------------------------------------------------------------------*/
+
+/**
+    Returns a cleared submission queue entry. The user data encodes the
+    file slot and the expected result of the request.
+*/
+static io_uring_sqe * get_sqe(unsigned slot, unsigned expected) {
+  unsigned tail = *sq_tail;
+  if (tail - __atomic_load_n(sq_head, __ATOMIC_ACQUIRE) == sq_entries)
+    submit();
+
+  unsigned i = tail & *sq_mask;
+  io_uring_sqe * sqe = sqes + i;
+  memset(sqe, 0, sizeof *sqe);
+  sqe->user_data = (static_cast<uint64_t>(slot) << 32) | expected;
+  sq_array[i] = i;
+  return sqe;
+}
+
+/*------------------------------------------------------------------------*/
+
+static void push_sqe() {
+  __atomic_store_n(sq_tail, *sq_tail + 1, __ATOMIC_RELEASE);
+  to_submit++;
+}
+
+/*------------------------------------------------------------------------*/
+
+/**
+    Queues the linked chain 'openat', 'write'*, 'close' for the job in 'slot'
+*/
+static void queue_job(unsigned slot) {
+  write_job & job = jobs[slot];
+
+  io_uring_sqe * sqe = get_sqe(slot, 0);
+  sqe->opcode = IORING_OP_OPENAT;
+  sqe->flags = IOSQE_IO_LINK;
+  sqe->fd = AT_FDCWD;
+  sqe->addr = reinterpret_cast<uint64_t>(job.name.c_str());
+  sqe->len = 0666;  // mode as used by fopen
+  sqe->open_flags = O_WRONLY | O_CREAT | O_TRUNC;  // no O_CLOEXEC for slots
+  sqe->file_index = slot + 1;
+  push_sqe();
+  job.pending = 1;
+
+  for (size_t offset = 0; offset < job.size; offset += max_write_chunk) {
+    size_t chunk = job.size - offset;
+    if (chunk > max_write_chunk) chunk = max_write_chunk;
+
+    sqe = get_sqe(slot, chunk);
+    sqe->opcode = IORING_OP_WRITE;
+    sqe->flags = IOSQE_FIXED_FILE | IOSQE_IO_LINK;
+    sqe->fd = slot;
+    sqe->addr = reinterpret_cast<uint64_t>(job.data + offset);
+    sqe->len = chunk;
+    sqe->off = offset;
+    push_sqe();
+    job.pending++;
+  }
+
+  sqe = get_sqe(slot, 0);
+  sqe->opcode = IORING_OP_CLOSE;
+  sqe->file_index = slot + 1;
+  push_sqe();
+  job.pending++;
+
+  submit();
+}
+
+/*------------------------------------------------------------------------*/
+
+static void finish_job(unsigned slot) {
+  write_job & job = jobs[slot];
+  if (job.failed) {
+    msg(2, "  io_uring failed to write '%s', writing synchronously",
+      job.name.c_str());
+    write_file_sync(job.name.c_str(), job.data, job.size);
+  }
+  free(job.data);
+  job.data = 0;
+  in_flight -= job.size;
+  free_slots.push_back(slot);
+}
+
+/*------------------------------------------------------------------------*/
+
+/**
+    Processes all available completions, waits for at least one if 'wait'
+*/
+static void reap(bool wait) {
+  while (wait && sys_io_uring_enter(0, 1, IORING_ENTER_GETEVENTS) < 0) {
+    if (errno != EINTR) die(writing_error, "failed to wait for io_uring");
+  }
+
+  unsigned head = *cq_head;
+  unsigned tail = __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE);
+  while (head != tail) {
+    const io_uring_cqe * cqe = cqes + (head & *cq_mask);
+    unsigned slot = cqe->user_data >> 32;
+    int expected = cqe->user_data & 0xffffffff;
+    write_job & job = jobs[slot];
+    if (cqe->res != expected) job.failed = 1;
+    if (!--job.pending) finish_job(slot);
+    head++;
+  }
+  __atomic_store_n(cq_head, head, __ATOMIC_RELEASE);
+}
+
+/*------------------------------------------------------------------------*/
+
+void init_async_writer(size_t max_in_flight) {
+  use_ring = setup_ring();
+  if (!use_ring) {
+    msg(1, "  io_uring not available, writing synchronously");
+    return;
+  }
+  in_flight_limit = max_in_flight;
+  in_flight = 0;
+  jobs.resize(file_slots);
+  free_slots.clear();
+  for (unsigned i = file_slots; i; i--) free_slots.push_back(i - 1);
+  msg(2, "  Initialized io_uring with %u file slots", file_slots);
+}
+
+/*------------------------------------------------------------------------*/
+
+void async_write_file(const char * name, char * data, size_t size) {
+  if (!use_ring) {
+    write_file_sync(name, data, size);
+    free(data);
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(ring_mutex);
+  while (free_slots.empty() || (in_flight && in_flight + size > in_flight_limit))
+    reap(1);
+
+  unsigned slot = free_slots.back();
+  free_slots.pop_back();
+
+  write_job & job = jobs[slot];
+  job.name = name;
+  job.data = data;
+  job.size = size;
+  job.failed = 0;
+  in_flight += size;
+
+  queue_job(slot);
+  reap(0);
+}
+
+/*------------------------------------------------------------------------*/
+
+void reset_async_writer() {
+  if (!use_ring) return;
+  while (free_slots.size() < file_slots) reap(1);
+  sys_io_uring_register(IORING_UNREGISTER_FILES, 0, 0);
+  unmap_ring();
+  use_ring = 0;
+}
+
+/*------------------------------------------------------------------------*/
+#else
+
+void init_async_writer(size_t) {
+  use_ring = 0;
+  msg(1, "  io_uring not compiled in, writing synchronously");
+}
+
+/*------------------------------------------------------------------------*/
+
+void async_write_file(const char * name, char * data, size_t size) {
+  write_file_sync(name, data, size);
+  free(data);
+}
+
+/*------------------------------------------------------------------------*/
+
+void reset_async_writer() {}
+
+#endif
+/*------------------------------------------------------------------------*/
+
+bool async_writer_uses_io_uring() {
+  return use_ring;
+}
+/*------------------------------------------------------------------------*/
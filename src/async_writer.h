@@ -0,0 +1,51 @@
+/*------------------------------------------------------------------------*/
+/*! \file async_writer.h
+    \brief contains the asynchronous output backend based on io_uring
+
+  Finished output files are queued as linked open/write/close requests
+  on a Linux io_uring while generation continues. The memory of queued
+  files is bounded, if the bound is reached writing waits for completions.
+  Without io_uring (not compiled in with 'HAVEIOURING' or not supported by
+  the kernel) files are written synchronously with stdio.
+
+  Part of MultAIGenFuzzer: Generation-Based AIG Fuzzer for Multipliers
+  Copyright(C) 2022 Daniela Kaufmann, Johannes Kepler University Linz
+*/
+/*------------------------------------------------------------------------*/
+#ifndef AIGENFUZZER_SRC_ASYNC_WRITER_H_
+#define AIGENFUZZER_SRC_ASYNC_WRITER_H_
+/*------------------------------------------------------------------------*/
+#include <stddef.h>
+
+#include "signal_statistics.h"
+/*------------------------------------------------------------------------*/
+
+/**
+    Sets up the io_uring, falls back to synchronous writes if that fails
+
+    @param max_in_flight maximal number of bytes of queued files
+*/
+void init_async_writer(size_t max_in_flight);
+
+/**
+    Queues writing 'size' bytes of 'data' to the file 'name'. Takes
+    ownership of 'data', which has been allocated with 'malloc'.
+    Can be called by several threads.
+
+    @param name name of output file, copied
+    @param data content of the file
+    @param size number of bytes
+*/
+void async_write_file(const char * name, char * data, size_t size);
+
+/**
+    Waits until all queued files are written and tears down the io_uring
+*/
+void reset_async_writer();
+
+/**
+    Returns whether files are written asynchronously
+*/
+bool async_writer_uses_io_uring();
+
+#endif  // AIGENFUZZER_SRC_ASYNC_WRITER_H_
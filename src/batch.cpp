@@ -0,0 +1,941 @@
+/*------------------------------------------------------------------------*/
+/*! \file batch.cpp
+    \brief contains the batch mode generating many multipliers in one run
+
+  Part of MultAIGenFuzzer: Generation-Based AIG Fuzzer for Multipliers
+  Copyright(C) 2022 Daniela Kaufmann, Johannes Kepler University Linz
+*/
+/*------------------------------------------------------------------------*/
+#include "batch.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <unordered_map>
+
+#include "async_writer.h"
+#include "corner_cases.h"
+#include "fuzzer.h"
+#include "model_queue.h"
+#include "simulate.h"
+#include "vectors.h"
+/*------------------------------------------------------------------------*/
+// Local Variables
+
+static const uint64_t seed_modulus = 2147483647;  // /< 2^31-1, prime
+static const uint64_t seed_multiplier = 48271;    // /< primitive root
+
+// / Maximal number of bytes queued by the asynchronous writer
+static const size_t async_in_flight = 256u << 20;
+
+/**
+    Archive entry of a parallel worker, waiting for the entries of all
+    instances with smaller index. With 'dedup' it also waits for the
+    decision whether the instance duplicates an earlier one.
+*/
+struct pending_entry {
+  char * data;      // /< binary AIGER, 0 if the instance is skipped
+  size_t size;      // /< number of bytes
+  archive_key key;  // /< key of the instance
+  uint64_t fingerprint;  // /< fingerprint of the written instance, or 0
+  std::vector<std::string> files;        // /< removed if a duplicate
+  std::vector<manifest_record> records;  // /< added unless a duplicate
+  uint64_t ands;    // /< gates counted unless a duplicate
+  uint64_t bytes;   // /< bytes counted unless a duplicate, 0 if nothing
+                    //    was written
+};
+
+static bool parallel;                   // /< several workers are running
+static manifest * batch_manifest;       // /< manifest of the batch, or 0
+static memory_options job_memory;       // /< options predicting memory
+
+// / Models in flight per generator of the pipeline, one is generated while
+// / the other is written
+static const unsigned pipeline_depth = 2;
+
+static model_queue ready_models;        // /< generated, waiting for writers
+static model_queue * returned_models;   // /< written, one per generator
+static std::atomic<unsigned> running_generators;
+
+static unsigned resume_error = 25;
+
+static std::mutex fingerprint_mutex;    // /< protects the following
+// / First job of the schedule with each fingerprint, its sequence plus 1,
+// / 0 for instances of other manifests
+static std::unordered_map<uint64_t, unsigned> fingerprints;
+static unsigned duplicates;             // /< dropped duplicate instances
+static std::vector<std::string> duplicate_files;  // /< removed at the end
+
+static std::atomic<unsigned> checked;   // /< instances checked by simulation
+static std::atomic<unsigned> exhausted; // /< checked on all patterns
+static std::atomic<unsigned> cornered;  // /< checked on directed vectors
+static std::atomic<unsigned> lived;     // /< checked while generated
+static unsigned check_threads;          // /< threads per simulation check
+static unsigned check_arrays;           // /< value arrays per random check
+static unsigned write_threads;          // /< threads per mapped file
+
+static std::mutex archive_mutex;        // /< protects the following
+static std::map<unsigned, pending_entry> pending_entries;
+static unsigned next_entry;             // /< sequence of next job to append
+/*------------------------------------------------------------------------*/
+
+unsigned batch_seed(unsigned seed, unsigned index) {
+  if (!index) return seed;
+  uint64_t res = seed % seed_modulus, factor = seed_multiplier;
+  if (!res) res = 1;
+  for (; index; index >>= 1) {
+    if (index & 1) res = res * factor % seed_modulus;
+    factor = factor * factor % seed_modulus;
+  }
+  return res;
+}
+
+/*------------------------------------------------------------------------*/
+
+/**
+    Parses a positive number at 'p', advances 'p' behind it
+*/
+static bool parse_width(const char ** p, unsigned * res) {
+  if (**p < '0' || **p > '9') return 0;
+  uint64_t n = 0;
+  while (**p >= '0' && **p <= '9') {
+    n = 10 * n + (*(*p)++ - '0');
+    if (n > 1u << 24) return 0;
+  }
+  *res = n;
+  return n > 0;
+}
+
+/*------------------------------------------------------------------------*/
+
+bool parse_widths(const char * spec, std::vector<unsigned> * widths) {
+  const char * p = spec;
+  for (;;) {
+    unsigned lower, upper, step = 1;
+    if (!parse_width(&p, &lower)) return 0;
+    upper = lower;
+    if (p[0] == '.' && p[1] == '.') {
+      p += 2;
+      if (!parse_width(&p, &upper) || upper < lower) return 0;
+      if (*p == ':') {
+        p++;
+        if (!parse_width(&p, &step)) return 0;
+      }
+    }
+    for (uint64_t w = lower; w <= upper; w += step) widths->push_back(w);
+    if (!*p) return 1;
+    if (*p++ != ',') return 0;
+  }
+}
+
+/*------------------------------------------------------------------------*/
+
+std::string expand_output_name(const char * pattern,
+                               unsigned width, unsigned seed) {
+  std::string res;
+  for (const char * p = pattern; *p; p++) {
+    if (*p != '%') {
+      res += *p;
+      continue;
+    }
+    switch (p[1]) {
+      case 'w': res += std::to_string(width); p++; break;
+      case 's': res += std::to_string(seed); p++; break;
+      case '%': res += '%'; p++; break;
+      default: res += '%';
+    }
+  }
+  return res;
+}
+
+/*------------------------------------------------------------------------*/
+
+/**
+    Sets 'job' to the job 'number' of the batch, instance 'number % count'
+    of width 'number / count'
+*/
+static void batch_job_of(const batch_settings & settings, unsigned number,
+                         batch_job * job) {
+  job->width = settings.widths[number / settings.count];
+  job->index = number % settings.count;
+  job->number = number;
+}
+
+/*------------------------------------------------------------------------*/
+
+/**
+    Collects the jobs of the shard except the 'finished' ones
+*/
+static std::vector<batch_job> shard_jobs(const batch_settings & settings,
+                                         const std::set<unsigned> & finished) {
+  std::vector<batch_job> jobs;
+  unsigned total = settings.widths.size() * settings.count;
+  for (unsigned number = settings.shard; number < total;
+       number += settings.shards) {
+    if (finished.count(number)) continue;
+    batch_job job;
+    batch_job_of(settings, number, &job);
+    jobs.push_back(job);
+  }
+  return jobs;
+}
+
+/*------------------------------------------------------------------------*/
+
+/**
+    Key of instance 'index' of 'width', the seed of the second multiplier
+    of a fuzzed miter is stored in the upper 32 bits of the seed
+*/
+static archive_key instance_key(const batch_settings & settings,
+                                unsigned width, unsigned index) {
+  archive_key res;
+  res.width = width;
+  res.seed = batch_seed(settings.seed, index);
+  res.options = (settings.use_cl ? 0 : archive_no_cla) |
+                (settings.reencode ? archive_reencoded : 0) |
+                (settings.miter ? archive_miter : 0);
+  if (settings.fuzzed_miter) {
+    res.options |= archive_fuzzed_miter;
+    res.seed |= static_cast<uint64_t>(batch_seed(settings.miter_seed,
+                                                 index)) << 32;
+  }
+  return res;
+}
+
+/*------------------------------------------------------------------------*/
+
+/**
+    Reads manifest and journal of an interrupted run of the batch into 'man'
+    and collects the numbers of its finished jobs. Dies if they were written
+    by a different batch.
+*/
+static std::set<unsigned> finished_jobs(const batch_settings & settings,
+                                        manifest * man) {
+  if (FILE * file = fopen(man->name, "r")) {
+    fclose(file);
+    read_manifest(man, man->name);
+  }
+  read_manifest_journal(man);
+  if (man->shard != settings.shard || man->shards != settings.shards)
+    die(resume_error, "manifest '%s' belongs to shard %u/%u", man->name,
+      man->shard, man->shards);
+
+  unsigned total = settings.widths.size() * settings.count;
+  std::set<unsigned> res;
+  for (size_t i = 0; i < man->records.size(); i++) {
+    const manifest_record & r = man->records[i];
+    batch_job job;
+    bool valid = r.index % settings.shards == settings.shard;
+    if (valid && settings.time_budget) campaign_job(r.index, &job);
+    else if (valid && r.index < total) batch_job_of(settings, r.index, &job);
+    else valid = 0;
+    archive_key key;
+    if (valid) key = instance_key(settings, job.width, job.index);
+    if (!valid || key.width != r.key.width || key.seed != r.key.seed ||
+        key.options != r.key.options)
+      die(resume_error, "manifest '%s' lists '%s' which is not part of "
+        "this batch", man->name, r.file.c_str());
+    res.insert(r.index);
+  }
+  msg(1, "  Resuming after %zu finished instances of manifest '%s'",
+    res.size(), man->name);
+  return res;
+}
+
+/*------------------------------------------------------------------------*/
+
+/**
+    Threads of each simulation check or mapped file of a batch with
+    'threads' workers, the cores left over by the workers
+*/
+static unsigned simulation_threads(unsigned threads) {
+  unsigned res = std::thread::hardware_concurrency() / threads;
+  return res ? res : 1;
+}
+
+/*------------------------------------------------------------------------*/
+
+/**
+    Options of the jobs of the batch which influence their memory. The
+    random check gets a value array per thread as far as the memory limit
+    allows, the number of arrays is halved until the jobs fit.
+*/
+static memory_options batch_memory_options(const batch_settings & settings,
+                                           unsigned threads) {
+  memory_options res;
+  for (size_t i = 0; i < settings.patterns.size(); i++)
+    res.formats.push_back(output_format_of(settings.patterns[i]));
+  res.use_cl = settings.use_cl;
+  res.reencode = settings.reencode;
+  res.compact_xor = settings.compact_xor;
+  res.buffered = settings.async;
+  res.buffered_archive = (threads > 1 || settings.writers) &&
+                         settings.archive_name;
+  res.simulation_words = settings.check ? simulation_words(settings.check)
+                                        : 0;
+  res.live_check = settings.check_live;
+  res.miter = settings.miter;
+  res.fuzzed_miter = settings.fuzzed_miter;
+  if (settings.vectors)
+    res.simulation_words = std::max(res.simulation_words,
+                                    simulation_words(settings.vectors));
+  if (settings.check_exhaustive || settings.check_corners)
+    res.simulation_words = max_simulation_words;
+
+  res.simulation_arrays = 1;
+  if (settings.check && !settings.check_shared) {
+    res.simulation_arrays = simulation_threads(threads);
+    unsigned width = *std::max_element(settings.widths.begin(),
+                                       settings.widths.end());
+    while (res.simulation_arrays > 1 && settings.memory_limit &&
+           threads * predicted_memory(width, res) > settings.memory_limit)
+      res.simulation_arrays /= 2;
+  }
+  return res;
+}
+
+/*------------------------------------------------------------------------*/
+
+/**
+    Claims 'fingerprint' for the job with 'sequence'. An earlier job of the
+    schedule with the same fingerprint wins, independent of the order in
+    which the workers finish, a later one is dropped when its entry is
+    finished.
+
+    @return false if an earlier job has the fingerprint, counted as
+            duplicate
+*/
+static bool claim_fingerprint(uint64_t fingerprint, unsigned sequence) {
+  std::lock_guard<std::mutex> lock(fingerprint_mutex);
+  std::pair<std::unordered_map<uint64_t, unsigned>::iterator, bool> res =
+    fingerprints.insert(std::make_pair(fingerprint, sequence + 1));
+  if (res.second) return 1;
+  if (res.first->second <= sequence) {
+    duplicates++;
+    return 0;
+  }
+  res.first->second = sequence + 1;
+  return 1;
+}
+
+/*------------------------------------------------------------------------*/
+
+/**
+    Checks whether an earlier job than 'sequence' claimed 'fingerprint',
+    final once the jobs before 'sequence' are generated
+*/
+static bool duplicates_earlier_job(uint64_t fingerprint, unsigned sequence) {
+  std::lock_guard<std::mutex> lock(fingerprint_mutex);
+  if (fingerprints.find(fingerprint)->second > sequence) return 0;
+  duplicates++;
+  return 1;
+}
+
+/*------------------------------------------------------------------------*/
+
+/**
+    Adds the fingerprints of the records of 'man', as far as known
+*/
+static void add_manifest_fingerprints(const manifest & man) {
+  for (size_t i = 0; i < man.records.size(); i++)
+    if (man.records[i].fingerprint)
+      fingerprints[man.records[i].fingerprint] = 0;
+}
+
+/*------------------------------------------------------------------------*/
+
+/**
+    Appends the archive entry of 'entry', adds its manifest records and
+    counts it, or drops it if it duplicates an earlier job
+*/
+static void commit_entry(archive * arch, unsigned sequence,
+                         pending_entry * entry) {
+  if (entry->fingerprint &&
+      duplicates_earlier_job(entry->fingerprint, sequence)) {
+    msg(1, "  Instance with seed %u duplicates an earlier instance",
+      static_cast<unsigned>(entry->key.seed));
+    duplicate_files.insert(duplicate_files.end(), entry->files.begin(),
+                           entry->files.end());
+    free(entry->data);
+    return;
+  }
+  if (entry->data) {
+    if (append_archive_entry(arch, entry->data, entry->size, entry->key))
+      msg(1,"  Appended fuzzed AIG with seed %llu to archive: '%s'",
+        static_cast<unsigned long long>(entry->key.seed), arch->name);
+    else
+      msg(1,"  Skipped fuzzed AIG with seed %llu already contained in "
+        "archive: '%s'", static_cast<unsigned long long>(entry->key.seed),
+        arch->name);
+    free(entry->data);
+  }
+  if (!entry->records.empty())
+    add_manifest_records(batch_manifest, entry->records);
+  if (entry->bytes) count_instance(entry->ands, entry->bytes);
+}
+
+/*------------------------------------------------------------------------*/
+
+/**
+    Finishes the entry of the job with 'sequence' and all pending entries
+    following it in the schedule, so archive and duplicates do not depend
+    on the thread count.
+*/
+static void finish_archive_entry(archive * arch, unsigned sequence,
+                                 const pending_entry & entry) {
+  std::lock_guard<std::mutex> lock(archive_mutex);
+  pending_entries[sequence] = entry;
+  std::map<unsigned, pending_entry>::iterator it;
+  while ((it = pending_entries.find(next_entry)) != pending_entries.end()) {
+    commit_entry(arch, next_entry, &it->second);
+    pending_entries.erase(it);
+    next_entry++;
+  }
+}
+
+/*------------------------------------------------------------------------*/
+
+/**
+    Finishes the entries still pending after a stop, whose jobs before them
+    in the schedule were not finished, in the order of the schedule. The
+    index of the archive is sorted by key anyway.
+*/
+static void flush_archive_entries(archive * arch) {
+  std::lock_guard<std::mutex> lock(archive_mutex);
+  std::map<unsigned, pending_entry>::iterator it;
+  for (it = pending_entries.begin(); it != pending_entries.end(); ++it)
+    commit_entry(arch, it->first, &it->second);
+  pending_entries.clear();
+}
+
+/*------------------------------------------------------------------------*/
+
+/**
+    Instance of the batch, passed from the generating to the writing stage
+*/
+struct instance {
+  batch_job job;       // /< job of the instance
+  archive_key key;     // /< width, seed and options
+  bool contained;      // /< already contained in the archive
+  aiger * model;       // /< generated model, 0 if nothing is written
+  uint64_t fingerprint;  // /< 'model_fingerprint', 0 if not computed
+  std::vector<std::string> vector_names;  // /< written vector files
+  std::vector<file_record> vector_files;  // /< their sizes and checksums
+  uint64_t vector_bytes;                  // /< bytes of the vector files
+  unsigned generator;  // /< worker whose memory holds 'model'
+  double seconds;      // /< generation time
+};
+
+/**
+    Simulates the 'model' of this thread as requested by the checks of
+    'settings' and writes the vector files of 'inst'
+
+    @param settings batch_settings
+    @param inst instance of the model
+    @param width input bit-width
+    @param seed seed of the instance
+*/
+static void simulate_instance(const batch_settings & settings,
+                              instance * inst, unsigned width,
+                              unsigned seed) {
+  if (!settings.check && !settings.check_exhaustive &&
+      !settings.check_corners && settings.vector_patterns.empty())
+    return;
+  // threads left over by the value arrays simulate the columns of large
+  // models, which needs the levelized layout
+  unsigned arrays = 1;
+  if (settings.check)
+    arrays = std::min<uint64_t>(check_arrays, simulated_patterns(
+      settings.check) / (64 * simulation_words(settings.check)));
+  bool levelized = settings.levelized || (check_threads / arrays > 1 &&
+                                          model->num_ands >= parallel_gates);
+
+  simulation_model sm;
+  init_simulation_model(&sm, model, width, levelized);
+  if (settings.check_exhaustive && width <= max_exhaustive_width) {
+    check_exhaustive(&sm, check_threads);
+    exhausted++;
+  } else if (settings.check) {
+    check_random(&sm, seed, settings.check, check_threads, check_arrays);
+    checked++;
+  }
+  if (settings.check_corners) {
+    check_corner_cases(&sm, check_threads);
+    cornered++;
+  }
+
+  for (size_t i = 0; i < settings.vector_patterns.size(); i++)
+    inst->vector_names.push_back(expand_output_name(
+      settings.vector_patterns[i], width, seed));
+  if (!inst->vector_names.empty())
+    inst->vector_bytes = write_vectors(&sm, seed, settings.vectors,
+                                       check_threads, inst->vector_names,
+                                       batch_manifest ? &inst->vector_files
+                                                      : 0);
+}
+
+/*------------------------------------------------------------------------*/
+
+/**
+    Generates the model of the job of 'inst'
+
+    @param settings batch_settings
+    @param inst instance, 'job' is set
+    @param arch archive to append to, or 0
+*/
+static void generate_model(const batch_settings & settings, instance * inst,
+                           archive * arch) {
+  const batch_job & job = inst->job;
+  unsigned width = job.width;
+  unsigned seed = batch_seed(settings.seed, job.index);
+  msg(2, "  Instance %u: width %u, seed %u", job.number, width, seed);
+
+  inst->key = instance_key(settings, width, job.index);
+
+  inst->contained = 0;
+  if (arch) {
+    std::lock_guard<std::mutex> lock(archive_mutex);
+    inst->contained = archive_contains(arch, inst->key);
+  }
+  if (inst->contained)
+    msg(1, "  Instance with seed %u is already contained in archive '%s'",
+      seed, arch->name);
+
+  double start = thread_time();
+  inst->model = 0;
+  inst->fingerprint = 0;
+  inst->vector_names.clear();
+  inst->vector_files.clear();
+  inst->vector_bytes = 0;
+  if ((arch && !inst->contained) || !settings.patterns.empty() ||
+      settings.check || settings.check_exhaustive ||
+      settings.check_corners || settings.check_live ||
+      !settings.vector_patterns.empty()) {
+    seed_fuzzer(seed);
+    init_aig(width);
+    set_live_check(settings.check_live, seed);
+    if (settings.fuzzed_miter)
+      generate_fuzzed_miter(width, settings.use_cl, inst->key.seed >> 32);
+    else if (settings.miter)
+      generate_reference_miter(width, settings.use_cl);
+    else generate_fuzzed_mult(width, settings.use_cl);
+    if (settings.check_live) lived++;
+    if (settings.dedup || batch_manifest)
+      inst->fingerprint = model_fingerprint();
+    if (settings.dedup &&
+        !claim_fingerprint(inst->fingerprint, job.sequence)) {
+      msg(1, "  Instance with seed %u duplicates an earlier instance", seed);
+      reset_aig();
+    } else {
+      simulate_instance(settings, inst, width, seed);
+      inst->model = detach_aig();
+    }
+  }
+  inst->seconds = thread_time() - start;
+}
+
+/*------------------------------------------------------------------------*/
+
+/**
+    Writes the model of 'inst' to its files and the archive
+
+    @param settings batch_settings
+    @param inst generated instance
+    @param arch archive to append to, or 0
+*/
+static void write_instance(const batch_settings & settings, instance * inst,
+                           archive * arch) {
+  const batch_job & job = inst->job;
+  const archive_key & key = inst->key;
+
+  std::vector<std::string> names;
+  for (size_t i = 0; i < settings.patterns.size(); i++)
+    names.push_back(expand_output_name(settings.patterns[i], key.width,
+                                       key.seed));
+
+  output_targets targets;
+  for (size_t i = 0; i < names.size(); i++)
+    targets.names.push_back(names[i].c_str());
+  targets.arch = inst->contained ? 0 : arch;
+  targets.key = key;
+  targets.async = settings.async;
+  targets.mapped = settings.mapped;
+  targets.mapped_threads = write_threads;
+
+  // workers collect their archive entry in memory
+  sink entry_sink;
+  targets.archive_sink = parallel && targets.arch ? &entry_sink : 0;
+
+  std::vector<file_record> files = inst->vector_files;
+  targets.records = batch_manifest ? &files : 0;
+  double start = thread_time();
+  unsigned ands = 0;
+
+  // a parallel worker may finish a duplicate before the earlier job, its
+  // records and statistics wait for the decision
+  bool deferred = parallel && settings.dedup;
+  pending_entry entry;
+  entry.data = 0;
+  entry.size = 0;
+  entry.key = key;
+  entry.fingerprint = deferred && inst->model ? inst->fingerprint : 0;
+  entry.ands = entry.bytes = 0;
+
+  if (inst->model) {
+    attach_aig(inst->model);
+    uint64_t bytes = write_fuzzed_model(targets, settings.reencode,
+                                        settings.compact_xor);
+    ands = model->num_ands;
+    inst->model = detach_aig();
+    // check-only runs write nothing
+    if (!targets.names.empty() || targets.arch || inst->vector_bytes) {
+      entry.ands = ands;
+      entry.bytes = bytes + inst->vector_bytes;
+      if (!deferred) count_instance(entry.ands, entry.bytes);
+    }
+    if (deferred) {
+      entry.files = names;
+      entry.files.insert(entry.files.end(), inst->vector_names.begin(),
+                         inst->vector_names.end());
+    }
+  }
+
+  if (batch_manifest && !files.empty()) {
+    std::vector<manifest_record> records(files.size());
+    for (size_t i = 0; i < files.size(); i++) {
+      records[i].key = key;
+      records[i].index = job.number;
+      records[i].ands = ands;
+      records[i].seconds = inst->seconds + thread_time() - start;
+      records[i].bytes = files[i].bytes;
+      records[i].checksum = files[i].checksum;
+      records[i].fingerprint = inst->fingerprint;
+      records[i].file = files[i].name;
+    }
+    if (deferred) entry.records = records;
+    else add_manifest_records(batch_manifest, records);
+  }
+
+  if (parallel && (arch || settings.dedup)) {
+    if (targets.archive_sink && inst->model)
+      entry.data = take_sink_buffer(&entry_sink, &entry.size);
+    finish_archive_entry(arch, job.sequence, entry);
+  }
+}
+
+/*------------------------------------------------------------------------*/
+
+/**
+    Resets the model of 'inst', called by the thread which generated it
+*/
+static void recycle_instance(instance * inst) {
+  if (!inst->model) return;
+  attach_aig(inst->model);
+  reset_aig();
+  inst->model = 0;
+}
+
+/*------------------------------------------------------------------------*/
+
+/**
+    Deallocates the model memory and buffers kept by the calling worker
+*/
+static void release_worker_memory() {
+  release_aig_memory();
+  reset_sink_buffers();
+#ifdef __GLIBC__
+  // otherwise the freed memory stays in the arena of this thread
+  malloc_trim(0);
+#endif
+}
+
+/*------------------------------------------------------------------------*/
+
+/**
+    Generates and writes instances until all jobs of the shard are taken
+*/
+static void run_worker(const batch_settings & settings, unsigned worker,
+                       archive * arch) {
+  instance inst;
+  inst.generator = worker;
+  while (next_batch_job(worker, &inst.job)) {
+    admit_job(worker, predicted_memory(inst.job.width, job_memory),
+              release_worker_memory);
+    generate_model(settings, &inst, arch);
+    write_instance(settings, &inst, arch);
+    recycle_instance(&inst);
+    finish_admitted_job(worker, release_worker_memory);
+  }
+
+  release_worker_memory();
+  leave_admission(worker);
+}
+
+/*------------------------------------------------------------------------*/
+
+/**
+    Takes an instance returned by the writers and recycles its model,
+    parks while none is returned
+
+    @param worker index of the generator
+*/
+static instance * take_returned_instance(unsigned worker) {
+  model_queue * q = &returned_models[worker];
+  void * item;
+  for (;;) {
+    unsigned changes = queue_changes(q);
+    if (pop_queue(q, &item)) break;
+    park_queue(q, changes);
+  }
+  instance * res = static_cast<instance *>(item);
+  recycle_instance(res);
+  return res;
+}
+
+/*------------------------------------------------------------------------*/
+
+/**
+    Appends 'item' to 'q', parks while 'q' is full
+*/
+static void push_parking(model_queue * q, void * item) {
+  for (;;) {
+    unsigned changes = queue_changes(q);
+    if (push_queue(q, item)) return;
+    park_queue(q, changes);
+  }
+}
+
+/*------------------------------------------------------------------------*/
+
+/**
+    Generating stage of the pipeline: generates models until all jobs of
+    the shard are taken and passes them to the writers. Each generator owns
+    'pipeline_depth' instances, which the writers return after writing.
+*/
+static void run_generator(const batch_settings & settings, unsigned worker,
+                          archive * arch) {
+  std::vector<instance *> instances;
+  for (unsigned i = 0; i < pipeline_depth; i++) {
+    instances.push_back(new instance);
+    instances.back()->generator = worker;
+    instances.back()->model = 0;
+  }
+  unsigned owned = pipeline_depth;
+
+  batch_job job;
+  while (next_batch_job(worker, &job)) {
+    instance * inst;
+    if (owned) inst = instances[--owned];
+    else inst = take_returned_instance(worker);
+
+    inst->job = job;
+    admit_job(worker, pipeline_depth * predicted_memory(job.width,
+              job_memory), release_worker_memory);
+    generate_model(settings, inst, arch);
+    push_parking(&ready_models, inst);
+    // the model is still in use by the writers
+    finish_admitted_job(worker, 0);
+  }
+
+  // the memory of the models is kept by this thread
+  for (; owned < pipeline_depth; owned++) take_returned_instance(worker);
+  for (unsigned i = 0; i < pipeline_depth; i++) delete instances[i];
+
+  release_worker_memory();
+  leave_admission(worker);
+  // idle writers check whether all generators are finished
+  if (!--running_generators) wake_queue(&ready_models);
+}
+
+/*------------------------------------------------------------------------*/
+
+/**
+    Writing stage of the pipeline: writes generated models and returns
+    them to their generators until all generators are finished
+*/
+static void run_writer(const batch_settings & settings, archive * arch) {
+  for (;;) {
+    void * item;
+    unsigned changes = queue_changes(&ready_models);
+    if (pop_queue(&ready_models, &item)) {
+      instance * inst = static_cast<instance *>(item);
+      write_instance(settings, inst, arch);
+      push_parking(&returned_models[inst->generator], inst);
+    } else if (!running_generators) {
+      break;  // generators wait for all their instances
+    } else {
+      park_queue(&ready_models, changes);
+    }
+  }
+  release_worker_memory();
+}
+
+/*------------------------------------------------------------------------*/
+
+/**
+    Runs 'generators' generating and 'settings.writers' writing threads
+    connected by lock-free queues
+*/
+static void run_pipeline(const batch_settings & settings,
+                         unsigned generators, archive * arch) {
+  init_queue(&ready_models, generators * pipeline_depth);
+  returned_models = new model_queue[generators];
+  for (unsigned g = 0; g < generators; g++)
+    init_queue(&returned_models[g], pipeline_depth);
+  running_generators = generators;
+
+  std::vector<std::thread> threads;
+  for (unsigned g = 0; g < generators; g++)
+    threads.push_back(std::thread(run_generator, std::cref(settings), g,
+                                  arch));
+  for (unsigned w = 0; w < settings.writers; w++)
+    threads.push_back(std::thread(run_writer, std::cref(settings), arch));
+  for (size_t t = 0; t < threads.size(); t++) threads[t].join();
+
+  for (unsigned g = 0; g < generators; g++)
+    reset_queue(&returned_models[g]);
+  delete [] returned_models;
+  returned_models = 0;
+  reset_queue(&ready_models);
+}
+
+/*------------------------------------------------------------------------*/
+
+void estimate_batch(const batch_settings & settings) {
+  unsigned threads = settings.threads;
+  unsigned jobs = settings.widths.size() * settings.count;
+  if (threads > jobs) threads = jobs;
+  if (!threads) threads = 1;
+  print_estimate(settings.widths, settings.count, threads,
+                 batch_memory_options(settings, threads));
+}
+
+/*------------------------------------------------------------------------*/
+
+void run_batch(const batch_settings & settings) {
+  archive arch;
+  if (settings.archive_name) open_archive(&arch, settings.archive_name);
+  if (settings.async) init_async_writer(async_in_flight);
+
+  manifest man;
+  batch_manifest = 0;
+  if (settings.manifest_name) {
+    init_manifest(&man, settings.manifest_name, settings.shard,
+                  settings.shards);
+    batch_manifest = &man;
+  }
+
+  // a campaign creates its jobs on demand
+  if (settings.time_budget)
+    init_campaign(settings.widths, settings.time_budget,
+                  settings.sample_widths, settings.seed, settings.shard,
+                  settings.shards);
+
+  std::set<unsigned> finished;
+  if (settings.resume) finished = finished_jobs(settings, &man);
+  if (batch_manifest) open_manifest_journal(batch_manifest);
+
+  fingerprints.clear();
+  duplicates = 0;
+  checked = 0;
+  exhausted = 0;
+  cornered = 0;
+  lived = 0;
+  if (settings.dedup) {
+    if (settings.resume) add_manifest_fingerprints(man);
+    for (size_t i = 0; i < settings.known.size(); i++) {
+      manifest known;
+      init_manifest(&known, settings.known[i], 0, 1);
+      read_manifest(&known, settings.known[i]);
+      add_manifest_fingerprints(known);
+    }
+    if (!settings.known.empty())
+      msg(1, "  Read %zu fingerprints of known instances", fingerprints.size());
+  }
+
+  std::vector<batch_job> jobs;
+  if (settings.time_budget) skip_campaign_jobs(finished);
+  else jobs = shard_jobs(settings, finished);
+  if (settings.shards > 1 && !settings.time_budget)
+    msg(1, "  Shard %u/%u generates %zu of %zu instances", settings.shard,
+      settings.shards, jobs.size(), settings.widths.size() * settings.count);
+
+  unsigned threads = settings.threads;
+  if (!settings.time_budget && threads > jobs.size()) threads = jobs.size();
+  if (!threads) threads = 1;
+  parallel = threads > 1 || settings.writers;
+  check_threads = simulation_threads(threads);
+  write_threads = simulation_threads(threads + settings.writers);
+  next_entry = 0;
+  init_scheduler(jobs, threads);
+
+  job_memory = batch_memory_options(settings, threads);
+  check_arrays = job_memory.simulation_arrays;
+  if (settings.check && !settings.check_shared && check_arrays < check_threads)
+    msg(1, "  Checks use %u value arrays for %u threads within the memory "
+      "limit", check_arrays, check_threads);
+  init_admission(settings.memory_limit, threads);
+
+  msg(1,"Output");
+  msg(1,"==========================================================");
+  archive * target = settings.archive_name ? &arch : 0;
+  if (settings.writers) {
+    run_pipeline(settings, threads, target);
+  } else if (parallel) {
+    std::vector<std::thread> workers;
+    for (unsigned t = 0; t < threads; t++)
+      workers.push_back(std::thread(run_worker, std::cref(settings), t,
+                                    target));
+    for (unsigned t = 0; t < threads; t++) workers[t].join();
+  } else {
+    run_worker(settings, 0, target);
+  }
+  reset_admission();
+  flush_archive_entries(target);
+  if (settings.time_budget)
+    msg(1, "  Campaign of %g seconds generated %u instances",
+      settings.time_budget, campaign_jobs());
+  if (settings.check_exhaustive)
+    msg(1, "  Checked %u instances on all input patterns",
+      static_cast<unsigned>(exhausted));
+  if (settings.check_corners)
+    msg(1, "  Checked %u instances on directed corner cases",
+      static_cast<unsigned>(cornered));
+  if (settings.check_live)
+    msg(1, "  Checked %u instances on 64 random patterns while generating",
+      static_cast<unsigned>(lived));
+  if (settings.check)
+    msg(1, "  Checked %u instances on %llu random patterns each",
+      static_cast<unsigned>(checked),
+      static_cast<unsigned long long>(simulated_patterns(settings.check)));
+  if (settings.dedup)
+    msg(1, "  Dropped %u duplicate instances", duplicates);
+  if (stop_signal && batch_manifest)
+    msg(1, "  Stopped by signal '%s', finished instances are listed in the "
+      "manifest, continue with '--resume'", signal_name(stop_signal));
+  else if (stop_signal)
+    msg(1, "  Stopped by signal '%s' after the instances in flight",
+      signal_name(stop_signal));
+  msg(1,"");
+  reset_scheduler();
+  fingerprints.clear();
+
+  if (settings.archive_name) close_archive(&arch);
+  if (settings.async) reset_async_writer();
+  // after the asynchronous writes of the files
+  for (size_t i = 0; i < duplicate_files.size(); i++)
+    remove(duplicate_files[i].c_str());
+  duplicate_files.clear();
+  if (batch_manifest) write_manifest(batch_manifest);
+  batch_manifest = 0;
+}
+/*------------------------------------------------------------------------*/
@@ -0,0 +1,168 @@
+/*------------------------------------------------------------------------*/
+/*! \file batch.h
+    \brief contains the batch mode generating many multipliers in one run
+
+  The instances generated by one thread share the model memory, the
+  slices and the output buffers. The seed of instance 'j' is derived
+  deterministically from the seed of the batch, output file names are
+  expanded from patterns containing the width and the seed of the instance.
+
+  Part of MultAIGenFuzzer: Generation-Based AIG Fuzzer for Multipliers
+  Copyright(C) 2022 Daniela Kaufmann, Johannes Kepler University Linz
+*/
+/*------------------------------------------------------------------------*/
+#ifndef AIGENFUZZER_SRC_BATCH_H_
+#define AIGENFUZZER_SRC_BATCH_H_
+/*------------------------------------------------------------------------*/
+#include <string>
+#include <vector>
+
+#include "aig.h"
+#include "estimate.h"
+#include "manifest.h"
+#include "scheduler.h"
+/*------------------------------------------------------------------------*/
+
+/**
+    Settings of a batch, parsed from the command line
+*/
+struct batch_settings {
+  std::vector<const char *> patterns;  // /< output file name patterns
+  const char * archive_name;           // /< archive to append to, or 0
+  std::vector<unsigned> widths;        // /< input bit-widths
+  unsigned seed;                       // /< seed of the first instance
+  unsigned count;                      // /< number of instances per width
+  unsigned threads;                    // /< number of worker threads
+  unsigned writers;                    // /< number of writer threads of
+                                       //    the pipeline, 0 without
+  unsigned shard;                      // /< generates instances 'j' with
+  unsigned shards;                     //    j % shards == shard
+  const char * manifest_name;          // /< manifest to write, or 0
+  bool use_cl;                         // /< carry-lookahead adders
+  bool miter;                          // /< miter with a reference array
+                                       //    multiplier
+  bool fuzzed_miter;                   // /< miter with a second fuzzed
+  unsigned miter_seed;                 //    multiplier, its seed of the
+                                       //    first instance
+  bool reencode;                       // /< reencode before writing
+  bool compact_xor;                    // /< compact XOR encoding in CNF
+  bool async;                          // /< write files with io_uring
+  bool mapped;                         // /< write binary files mapped
+  size_t memory_limit;                 // /< admission limit, 0 if unlimited
+  double time_budget;                  // /< seconds of a campaign, 0 for
+                                       //    'count' instances per width
+  bool sample_widths;                  // /< campaign draws the widths
+  bool resume;                         // /< skips the jobs listed in the
+                                       //    manifest and its journal
+  uint64_t check;                       // /< random patterns simulated to
+                                       //    check each instance, 0 without
+  bool check_exhaustive;               // /< simulates instances up to
+                                       //    'max_exhaustive_width' on all
+                                       //    input patterns
+  bool check_corners;                  // /< simulates the directed vectors
+                                       //    of 'corner_cases'
+  bool levelized;                      // /< simulates levelized models
+  bool check_shared;                   // /< one value array per check
+  bool check_live;                     // /< simulates 64 patterns while
+                                       //    the gates are generated
+  uint64_t vectors;                     // /< test vectors per instance
+  std::vector<const char *> vector_patterns;  // /< vector file name
+                                              //    patterns
+  bool dedup;                          // /< drops instances with the
+                                       //    fingerprint of an earlier one
+  std::vector<const char *> known;     // /< manifests of instances
+                                       //    generated before, for 'dedup'
+};
+
+/**
+    Returns the seed of instance 'index' of a batch starting with 'seed'.
+    The seeds follow the minimal standard generator modulo 2^31-1, hence
+    they are distinct within a batch and can be passed to '-s'.
+
+    @param seed seed of the batch, returned for index 0
+    @param index index of the instance
+
+    @return unsigned
+*/
+unsigned batch_seed(unsigned seed, unsigned index);
+
+/**
+    Parses a list of widths separated by ',', each given as 'n', as range
+    'a..b' or as range with step 'a..b:s', e.g. '4..1024:4,2048'
+
+    @param spec width specification
+    @param widths receives the widths
+
+    @return false if 'spec' is invalid
+*/
+bool parse_widths(const char * spec, std::vector<unsigned> * widths);
+
+/**
+    Expands '%w' to the width, '%s' to the seed and '%%' to '%'
+
+    @param pattern output file name pattern
+    @param width input bit-width of the instance
+    @param seed seed of the instance
+
+    @return std::string
+*/
+std::string expand_output_name(const char * pattern,
+                               unsigned width, unsigned seed);
+
+/**
+    Generates and writes all instances of the batch, 'count' instances for
+    each width, or as many as possible within the time budget of a
+    campaign.
+
+    With several threads each worker owns its generator state and takes
+    jobs from the work-stealing scheduler, largest first. Since seeds only
+    depend on the index of the instance, files and archive do not depend
+    on the number of threads, and shards of the batch can be generated on
+    different machines. With a memory limit, jobs are only started when
+    their predicted peak memory fits. With writers, the workers only
+    generate and pass their models through a lock-free queue to the
+    writer threads, which return them for reuse after writing.
+
+    A stop signal ends the batch after the instances in flight, the
+    manifest lists the finished instances for resuming.
+
+    With 'dedup', instances whose 'model_fingerprint' was already emitted
+    by the batch, by the resumed run or by the 'known' manifests of other
+    shards are not written. Of two duplicates the earlier job of the
+    schedule is kept for any number of threads.
+
+    With 'check' each generated model is simulated on random patterns
+    before it is written, with 'check_exhaustive' small models are
+    simulated on all patterns by the cores left over by the workers, with
+    'check_corners' on directed vectors stressing carry propagation. With
+    'levelized' the checks simulate the gates level by level, the gates of
+    a level on the cores left over by the workers. The random patterns of
+    'check' are split into blocks simulated by these cores with private
+    value arrays, with 'check_shared' or if the arrays exceed the memory
+    limit the cores share one array and simulate the gates level by
+    level. With 'check_live' each gate is simulated on 64 random patterns
+    as it is generated and each output is compared when it is added,
+    without another pass over the model.
+
+    With 'vectors' the workers simulate that many random patterns on each
+    model and write them with their products to the 'vector_patterns'
+    files.
+
+    With 'miter' each instance is the miter of the fuzzed and a reference
+    array multiplier, the checks simulate its output. With 'fuzzed_miter'
+    the second multiplier of instance 'j' is fuzzed with seed
+    'batch_seed(miter_seed, j)'.
+
+    @param settings batch_settings
+*/
+void run_batch(const batch_settings & settings);
+
+/**
+    Prints the predicted gates, sizes, memory and time of the batch
+    without generating it
+
+    @param settings batch_settings
+*/
+void estimate_batch(const batch_settings & settings);
+
+#endif  // AIGENFUZZER_SRC_BATCH_H_
@@ -0,0 +1,177 @@
+/*------------------------------------------------------------------------*/
+/*! \file cnf.cpp
+    \brief contains functions necessary to write the AIG in DIMACS format
+
+  Part of MultAIGenFuzzer: Generation-Based AIG Fuzzer for Multipliers
+  Copyright(C) 2022 Daniela Kaufmann, Johannes Kepler University Linz
+*/
+/*------------------------------------------------------------------------*/
+#include "cnf.h"
+
+#include <vector>
+/*------------------------------------------------------------------------*/
+// Local Variables
+
+// / maps variable to AND index + 1
+static thread_local std::vector<unsigned> and_of;
+// / number of references per variable
+static thread_local std::vector<unsigned> refs;
+// / AND is only used inside an XOR
+static thread_local std::vector<bool> dropped;
+// / XOR detection enabled
+static thread_local bool compact;
+/*------------------------------------------------------------------------*/
+
+static int cnf_lit(unsigned lit) {
+  assert(lit > 1);
+  int res = aiger_lit2var(lit);
+  return aiger_sign(lit) ? -res : res;
+}
+
+/*------------------------------------------------------------------------*/
+
+static aiger_and * defining_and(unsigned lit) {
+  unsigned i = and_of[aiger_lit2var(lit)];
+  return i ? model->ands + i - 1 : 0;
+}
+
+/*------------------------------------------------------------------------*/
+
+/**
+    Checks whether 'gate' is of the form AND(!AND(p,q), !AND(!p,!q)),
+    which is equivalent to XOR(p,q).
+
+    @param gate AND gate
+    @param p first XOR input, set on success
+    @param q second XOR input, set on success
+
+    @return true if 'gate' is an XOR
+*/
+static bool match_xor(const aiger_and * gate, unsigned * p, unsigned * q) {
+  if (!aiger_sign(gate->rhs0) || !aiger_sign(gate->rhs1)) return 0;
+
+  const aiger_and * x = defining_and(gate->rhs0);
+  const aiger_and * y = defining_and(gate->rhs1);
+  if (!x || !y) return 0;
+
+  if ((x->rhs0 == aiger_not(y->rhs0) && x->rhs1 == aiger_not(y->rhs1)) ||
+      (x->rhs0 == aiger_not(y->rhs1) && x->rhs1 == aiger_not(y->rhs0))) {
+    *p = x->rhs0;
+    *q = x->rhs1;
+    return 1;
+  }
+  return 0;
+}
+
+/*------------------------------------------------------------------------*/
+
+unsigned prepare_cnf(bool compact_xor) {
+  compact = compact_xor;
+  if (!compact) return 3 * model->num_ands;
+
+  and_of.assign(model->maxvar + 1, 0);
+  refs.assign(model->maxvar + 1, 0);
+  dropped.assign(model->num_ands, 0);
+
+  for (unsigned i = 0; i < model->num_ands; i++) {
+    aiger_and * gate = model->ands + i;
+    and_of[aiger_lit2var(gate->lhs)] = i + 1;
+    refs[aiger_lit2var(gate->rhs0)]++;
+    refs[aiger_lit2var(gate->rhs1)]++;
+  }
+  for (unsigned i = 0; i < model->num_outputs; i++)
+    refs[aiger_lit2var(model->outputs[i].lit)]++;
+
+  unsigned p, q;
+  for (unsigned i = 0; i < model->num_ands; i++) {
+    aiger_and * gate = model->ands + i;
+    if (!match_xor(gate, &p, &q)) continue;
+    if (refs[aiger_lit2var(gate->rhs0)] == 1)
+      dropped[and_of[aiger_lit2var(gate->rhs0)] - 1] = 1;
+    if (refs[aiger_lit2var(gate->rhs1)] == 1)
+      dropped[and_of[aiger_lit2var(gate->rhs1)] - 1] = 1;
+  }
+
+  unsigned res = 0, xors = 0;
+  for (unsigned i = 0; i < model->num_ands; i++) {
+    if (dropped[i]) continue;
+    if (match_xor(model->ands + i, &p, &q)) xors++;
+    else res += 3;
+  }
+  res += 4 * xors;
+
+  msg(2, "  Detected %u XOR gates for CNF encoding", xors);
+  return res;
+}
+
+/*------------------------------------------------------------------------*/
+
+static void write_symbols(sink * s, char type, aiger_symbol * symbols,
+                          unsigned size) {
+  for (unsigned i = 0; i < size; i++) {
+    sink_put_s(s, "c ");
+    sink_put_ch(s, type);
+    sink_put_ch(s, ' ');
+    sink_put_u(s, i);
+    sink_put_ch(s, ' ');
+    sink_put_i(s, cnf_lit(symbols[i].lit));
+    if (symbols[i].name) {
+      sink_put_ch(s, ' ');
+      sink_put_s(s, symbols[i].name);
+    }
+    sink_put_ch(s, '\n');
+  }
+}
+
+/*------------------------------------------------------------------------*/
+
+void write_cnf_header(sink * s, unsigned clauses) {
+  write_symbols(s, 'i', model->inputs, model->num_inputs);
+  write_symbols(s, 'o', model->outputs, model->num_outputs);
+  sink_put_s(s, "p cnf ");
+  sink_put_u(s, model->maxvar);
+  sink_put_ch(s, ' ');
+  sink_put_u(s, clauses);
+  sink_put_ch(s, '\n');
+}
+
+/*------------------------------------------------------------------------*/
+
+static void write_clause(sink * s, int a, int b) {
+  sink_put_i(s, a);
+  sink_put_ch(s, ' ');
+  sink_put_i(s, b);
+  sink_put_s(s, " 0\n");
+}
+
+/*------------------------------------------------------------------------*/
+
+static void write_clause(sink * s, int a, int b, int c) {
+  sink_put_i(s, a);
+  sink_put_ch(s, ' ');
+  write_clause(s, b, c);
+}
+
+/*------------------------------------------------------------------------*/
+
+void write_cnf_gate(sink * s, unsigned i) {
+  if (compact && dropped[i]) return;
+
+  aiger_and * gate = model->ands + i;
+  int lhs = cnf_lit(gate->lhs);
+  unsigned p, q;
+
+  if (compact && match_xor(gate, &p, &q)) {
+    int a = cnf_lit(p), b = cnf_lit(q);
+    write_clause(s, -lhs,  a,  b);
+    write_clause(s, -lhs, -a, -b);
+    write_clause(s,  lhs, -a,  b);
+    write_clause(s,  lhs,  a, -b);
+  } else {
+    int a = cnf_lit(gate->rhs0), b = cnf_lit(gate->rhs1);
+    write_clause(s, -lhs, a);
+    write_clause(s, -lhs, b);
+    write_clause(s, lhs, -a, -b);
+  }
+}
+/*------------------------------------------------------------------------*/
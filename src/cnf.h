@@ -0,0 +1,49 @@
+/*------------------------------------------------------------------------*/
+/*! \file cnf.h
+    \brief contains functions necessary to write the AIG in DIMACS format
+
+  Part of MultAIGenFuzzer: Generation-Based AIG Fuzzer for Multipliers
+  Copyright(C) 2022 Daniela Kaufmann, Johannes Kepler University Linz
+*/
+/*------------------------------------------------------------------------*/
+#ifndef AIGENFUZZER_SRC_CNF_H_
+#define AIGENFUZZER_SRC_CNF_H_
+/*------------------------------------------------------------------------*/
+#include "aig.h"
+#include "writer.h"
+/*------------------------------------------------------------------------*/
+
+/**
+    Prepares writing the 'aiger* model' as DIMACS CNF using the Tseitin
+    encoding, i.e., three clauses per AND gate. AIG variable 'v' is mapped
+    to CNF variable 'v'.
+
+    If 'compact_xor' is set, AND gates computing the XOR of two literals
+    (as generated by the half and full adders) are encoded by four clauses,
+    and the two inner gates are dropped if they have no further fanout.
+    Detecting them needs one pass over the gates to count references.
+
+    @param compact_xor enables XOR detection
+
+    @return number of clauses
+*/
+unsigned prepare_cnf(bool compact_xor);
+
+/**
+    Writes the variable map and the DIMACS header. Inputs and outputs are
+    listed as 'c i' and 'c o' comment lines in front of the header.
+
+    @param s sink
+    @param clauses number of clauses as returned by 'prepare_cnf'
+*/
+void write_cnf_header(sink * s, unsigned clauses);
+
+/**
+    Writes the clauses of the i-th AND gate of the 'aiger* model'
+
+    @param s sink
+    @param i index of AND gate
+*/
+void write_cnf_gate(sink * s, unsigned i);
+
+#endif  // AIGENFUZZER_SRC_CNF_H_
@@ -0,0 +1,223 @@
+/*------------------------------------------------------------------------*/
+/*! \file corner_cases.cpp
+    \brief contains directed input vectors checking carry propagation
+
+  Part of MultAIGenFuzzer: Generation-Based AIG Fuzzer for Multipliers
+  Copyright(C) 2022 Daniela Kaufmann, Johannes Kepler University Linz
+*/
+/*------------------------------------------------------------------------*/
+#include "corner_cases.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "simulate.h"
+/*------------------------------------------------------------------------*/
+// Local Variables
+
+/**
+    Operands of the fixed vectors
+*/
+enum corner_operand {
+  zero_operand,         // /< 0
+  one_operand,          // /< 1
+  ones_operand,         // /< 2^n - 1
+  ones_even_operand,    // /< 2^n - 2
+  alternating_operand,  // /< ...0101
+  shifted_operand       // /< ...1010
+};
+
+// / Fixed vectors independent of the bit position
+static const corner_operand fixed_cases[][2] = {
+  { zero_operand, zero_operand }, { zero_operand, ones_operand },
+  { ones_operand, zero_operand }, { one_operand, one_operand },
+  { one_operand, ones_operand }, { ones_operand, one_operand },
+  { ones_operand, ones_operand }, { ones_operand, ones_even_operand },
+  { ones_even_operand, ones_operand },
+  { ones_even_operand, ones_even_operand },
+  { alternating_operand, alternating_operand },
+  { alternating_operand, shifted_operand },
+  { shifted_operand, alternating_operand },
+  { shifted_operand, shifted_operand },
+  { alternating_operand, ones_operand }, { ones_operand, alternating_operand },
+  { shifted_operand, ones_operand }, { ones_operand, shifted_operand }
+};
+
+static const unsigned fixed_count = sizeof fixed_cases / sizeof fixed_cases[0];
+
+// / Families of vectors with one vector per bit position 'k'
+enum corner_family {
+  power_times_ones,      // /< 2^k * (2^n - 1)
+  ones_times_power,
+  low_ones_times_ones,   // /< (2^(k+1) - 1) * (2^n - 1)
+  ones_times_low_ones,
+  low_ones_squared,      // /< (2^(k+1) - 1)^2
+  high_ones_times_ones,  // /< (2^n - 2^k) * (2^n - 1)
+  ones_times_high_ones,
+  walking_zero_times_ones,  // /< (2^n - 1 - 2^k) * (2^n - 1)
+  ones_times_walking_zero,
+  opposite_powers,       // /< 2^k * 2^(n-1-k)
+  power_plus_one_times_ones,  // /< (2^k + 1) * (2^n - 1)
+  ones_times_power_plus_one,
+  corner_families
+};
+/*------------------------------------------------------------------------*/
+
+unsigned corner_cases(unsigned width) {
+  return fixed_count + corner_families * width;
+}
+
+/*------------------------------------------------------------------------*/
+
+/**
+    Sets 'x' to the fixed operand 'operand' of 'width' bits
+*/
+static void set_operand(mpz_t x, corner_operand operand, unsigned width) {
+  mpz_set_ui(x, 0);
+  switch (operand) {
+    case zero_operand: break;
+    case one_operand: mpz_set_ui(x, 1); break;
+    case ones_operand:
+    case ones_even_operand:
+      mpz_setbit(x, width);
+      mpz_sub_ui(x, x, operand == ones_operand ? 1 : 2);
+      break;
+    case alternating_operand:
+    case shifted_operand:
+      for (unsigned k = operand == shifted_operand; k < width; k += 2)
+        mpz_setbit(x, k);
+      break;
+  }
+}
+
+/*------------------------------------------------------------------------*/
+
+void corner_case(unsigned width, unsigned index, mpz_t a, mpz_t b) {
+  assert(index < corner_cases(width));
+  if (index < fixed_count) {
+    set_operand(a, fixed_cases[index][0], width);
+    set_operand(b, fixed_cases[index][1], width);
+    return;
+  }
+
+  index -= fixed_count;
+  corner_family family = static_cast<corner_family>(index / width);
+  unsigned k = index % width;
+  mpz_t ones, x;
+  mpz_init(ones);
+  mpz_init(x);
+  set_operand(ones, ones_operand, width);
+
+  // 'x' is the operand depending on 'k', the other one is all-ones
+  bool swapped = 0;
+  switch (family) {
+    case ones_times_power: swapped = 1;  // fall through
+    case power_times_ones:
+      mpz_setbit(x, k);
+      break;
+    case ones_times_low_ones: swapped = 1;  // fall through
+    case low_ones_times_ones:
+    case low_ones_squared:
+      mpz_setbit(x, k + 1);
+      mpz_sub_ui(x, x, 1);
+      break;
+    case ones_times_high_ones: swapped = 1;  // fall through
+    case high_ones_times_ones:
+      mpz_setbit(x, k);
+      mpz_sub(x, ones, x);
+      mpz_add_ui(x, x, 1);
+      break;
+    case ones_times_walking_zero: swapped = 1;  // fall through
+    case walking_zero_times_ones:
+      mpz_set(x, ones);
+      mpz_clrbit(x, k);
+      break;
+    case opposite_powers:
+      mpz_setbit(x, k);
+      mpz_set_ui(ones, 0);
+      mpz_setbit(ones, width - 1 - k);
+      break;
+    case ones_times_power_plus_one: swapped = 1;  // fall through
+    case power_plus_one_times_ones:
+      mpz_setbit(x, k);
+      mpz_add_ui(x, x, 1);
+      break;
+    default: assert(0);
+  }
+  if (family == low_ones_squared) mpz_set(ones, x);
+
+  mpz_set(swapped ? b : a, x);
+  mpz_set(swapped ? a : b, ones);
+  mpz_clear(x);
+  mpz_clear(ones);
+}
+
+/*------------------------------------------------------------------------*/
+
+/**
+    Sets bit 'pattern' of the blocks of the set bits of 'x'
+*/
+static void set_pattern_bits(const mpz_t x, uint64_t * blocks,
+                             const unsigned * offsets, unsigned pattern) {
+  uint64_t bit = 1ull << (pattern % 64);
+  for (mp_bitcnt_t k = mpz_scan1(x, 0); k != ~static_cast<mp_bitcnt_t>(0);
+       k = mpz_scan1(x, k + 1))
+    blocks[offsets[k] + pattern / 64] |= bit;
+}
+
+/*------------------------------------------------------------------------*/
+
+void check_corner_cases(const simulation_model * sm, unsigned threads) {
+  double start = wall_clock_time();
+  unsigned width = sm->width, count = corner_cases(width);
+  unsigned words = simulation_words(count);
+  unsigned block = 64 * words;
+  uint64_t * values = allocate_words(simulation_variables(sm) * words);
+  std::vector<uint64_t> product(2 * width * words);
+
+  // offsets of the blocks of the bits of 'a', 'b' and the product
+  std::vector<unsigned> a_offsets(width), b_offsets(width);
+  std::vector<unsigned> product_offsets(2 * width);
+  for (unsigned i = 0; i < width; i++) {
+    a_offsets[i] = (i + 1) * words;
+    b_offsets[i] = (width + i + 1) * words;
+  }
+  for (unsigned k = 0; k < 2 * width; k++) product_offsets[k] = k * words;
+
+  mpz_t a, b, p;
+  mpz_init(a);
+  mpz_init(b);
+  mpz_init(p);
+  for (unsigned first = 0; first < count; first += block) {
+    for (unsigned i = 0; i < width; i++) {
+      memset(values + a_offsets[i], 0, words * sizeof(uint64_t));
+      memset(values + b_offsets[i], 0, words * sizeof(uint64_t));
+    }
+    std::fill(product.begin(), product.end(), 0);
+
+    // patterns after the last vector multiply 0 by 0
+    for (unsigned j = 0; j < block && first + j < count; j++) {
+      corner_case(width, first + j, a, b);
+      mpz_mul(p, a, b);
+      set_pattern_bits(a, values, &a_offsets[0], j);
+      set_pattern_bits(b, values, &b_offsets[0], j);
+      set_pattern_bits(p, &product[0], &product_offsets[0], j);
+    }
+
+    simulate_model(sm, values, words, threads);
+    unsigned pattern;
+    if (find_mismatch(sm, values, &product[0], words, &pattern))
+      report_counterexample(sm, values, &product[0], words, pattern);
+  }
+  mpz_clear(a);
+  mpz_clear(b);
+  mpz_clear(p);
+  free(values);
+
+  msg(2, "  Checked %u corner cases in %.3f seconds", count,
+    wall_clock_time() - start);
+}
+/*------------------------------------------------------------------------*/
@@ -0,0 +1,52 @@
+/*------------------------------------------------------------------------*/
+/*! \file corner_cases.h
+    \brief contains directed input vectors checking carry propagation
+
+  Random patterns rarely propagate a carry through many columns, yet the
+  carry chains of the final stage adders are where carry-lookahead bugs
+  hide. The directed vectors combine all-ones, powers of two, runs of ones,
+  walking zeros and alternating bits for every bit position, about 12 n
+  vectors for width n. Their exact products are computed with GMP and
+  compared with the simulated outputs of the model.
+
+  Part of MultAIGenFuzzer: Generation-Based AIG Fuzzer for Multipliers
+  Copyright(C) 2022 Daniela Kaufmann, Johannes Kepler University Linz
+*/
+/*------------------------------------------------------------------------*/
+#ifndef AIGENFUZZER_SRC_CORNER_CASES_H_
+#define AIGENFUZZER_SRC_CORNER_CASES_H_
+/*------------------------------------------------------------------------*/
+#include <gmp.h>
+
+#include "simulate.h"
+/*------------------------------------------------------------------------*/
+
+/**
+    Number of directed vectors of 'width'
+
+    @param width input bit-width
+
+    @return unsigned
+*/
+unsigned corner_cases(unsigned width);
+
+/**
+    Sets 'a' and 'b' to directed vector 'index'
+
+    @param width input bit-width
+    @param index index of the vector, less than 'corner_cases(width)'
+    @param a receives the first operand
+    @param b receives the second operand
+*/
+void corner_case(unsigned width, unsigned index, mpz_t a, mpz_t b);
+
+/**
+    Simulates 'sm' on all directed vectors and dies with a counterexample
+    if an output differs from the product computed by GMP
+
+    @param sm simulated model
+    @param threads threads simulating the gates of a level
+*/
+void check_corner_cases(const simulation_model * sm, unsigned threads);
+
+#endif  // AIGENFUZZER_SRC_CORNER_CASES_H_
@@ -0,0 +1,351 @@
+/*------------------------------------------------------------------------*/
+/*! \file estimate.cpp
+    \brief contains the cost model of generated multipliers
+
+  Part of MultAIGenFuzzer: Generation-Based AIG Fuzzer for Multipliers
+  Copyright(C) 2022 Daniela Kaufmann, Johannes Kepler University Linz
+*/
+/*------------------------------------------------------------------------*/
+#include "estimate.h"
+
+#include <limits.h>
+#include <math.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <string>
+
+#include "fuzzer.h"
+#include "scheduler.h"
+/*------------------------------------------------------------------------*/
+// Local Variables
+
+// / gates per n^2: partial product, one full adder with 9 gates on average
+// / and half a half adder with 3.5 gates on average
+static const double quadratic_ands = 1 + 9 + 0.5 * 3.5;
+
+// / gates per n, fitted to the bits left for the final stage adder
+static const double linear_ands = -19.6;
+static const double linear_ands_no_cla = -21;
+
+// / variance of the gates per n^2: number of half adders (0.75 n^2 times
+// / 3.5^2) and type of full (4 n^2) and half adders (0.125 n^2)
+static const double variance_ands = 0.75 * 3.5 * 3.5 + 4 + 0.125;
+
+// / bytes per gate of the model, including the growth slack of its stacks
+static const double model_bytes = 53;
+
+// / bytes per gate added by reencoding, needed by binary output
+static const double reencode_bytes = 19;
+
+// / bytes per gate of the tables of the XOR detection for CNF
+static const double xor_bytes = 8;
+
+// / bytes per gate and simulation word of the check
+static const double simulation_bytes = 8;
+
+// / bytes per gate of the simulated copy of the model and of the tables
+// / renumbering and levelizing it
+static const double layout_bytes = 28;
+
+// / bytes per job independent of the width (slices, sink buffers)
+static const double job_bytes = 4 << 20;
+
+// / bytes of the two deltas of a binary gate with short deltas
+static const double delta_bytes = 2.35;
+
+// / seconds per unit of 'predicted_cost' if not calibrated
+static const double default_throughput = 3.3e-6;
+
+// / calibration file in the home directory, one line per host
+static const char * calibration_file = ".multaigenfuzzer";
+
+// / widths generated by '--calibrate'
+static const unsigned calibration_widths[] = { 128, 256, 384, 512 };
+
+static int calibration_error = 24;
+/*------------------------------------------------------------------------*/
+
+double expected_ands(unsigned width, bool use_cl) {
+  double n = width;
+  double res = quadratic_ands * n * n;
+  res += (use_cl ? linear_ands : linear_ands_no_cla) * n;
+  return res > n * n ? res : n * n;
+}
+
+/*------------------------------------------------------------------------*/
+
+double deviation_ands(unsigned width) {
+  return sqrt(variance_ands) * width;
+}
+
+/*------------------------------------------------------------------------*/
+
+/**
+    Number of gates of a carry-lookahead adder of 'size' slices with
+    iterative carries, the largest kind generated by 'generate_cla'
+*/
+static double iterative_cla_ands(double size) {
+  double res = 7 * size;  // propagate, generate and output XOR
+  for (double i = 0; i < size; i++) res += (i + 1) * (i + 2) / 2 + i + 1;
+  return res;
+}
+
+/*------------------------------------------------------------------------*/
+
+double worst_case_ands(unsigned width, bool use_cl) {
+  double res = expected_ands(width, use_cl) + 6 * deviation_ands(width);
+  if (!use_cl) return res;
+
+  // the number of gates of carry-lookahead adders is cubic in their size,
+  // the size halves its probability with each slice, about n/2 adders
+  double size = ceil(log2(width / 2.0 + 1) + 9 * log2(10));
+  if (size > 2.0 * width) size = 2.0 * width;
+  return res + iterative_cla_ands(size);
+}
+
+/*------------------------------------------------------------------------*/
+
+double miter_ands(unsigned width, const memory_options & options) {
+  double n = width, compare = 3 * 2 * n + 2 * n - 1;
+  if (options.fuzzed_miter)
+    return expected_ands(width, options.use_cl) + compare;
+  if (!options.miter) return 0;
+  double half_adders = n, full_adders = (n - 1) * (n - 1) - 1;
+  return n * n + 4 * half_adders + 9 * full_adders + compare;
+}
+
+/*------------------------------------------------------------------------*/
+
+/**
+    Number of decimal digits of 'x'
+*/
+static double digits(double x) {
+  return x < 10 ? 1 : floor(log10(x)) + 1;
+}
+
+/**
+    Number of bytes of 'x' in the variable-length delta encoding
+*/
+static double varint_bytes(double x) {
+  double res = 1;
+  for (; x >= 128; x /= 128) res++;
+  return res;
+}
+
+/*------------------------------------------------------------------------*/
+
+double binary_size(unsigned width, double ands) {
+  double n = width;
+  double maxvar = 2 * n + ands;
+
+  double header = 12 + digits(maxvar) + 2 * digits(2 * n) + digits(ands);
+  double outputs = 2 * n * (digits(maxvar) + 1);
+  double symbols = 4 * n * (digits(2 * n) + digits(n) + 4);
+
+  // the deltas of partial products span the literals of the whole model
+  double long_deltas = varint_bytes(2 * maxvar) + varint_bytes(4 * n) - 2;
+  double gates = ands * delta_bytes + n * n * long_deltas;
+
+  return header + outputs + symbols + gates;
+}
+
+/*------------------------------------------------------------------------*/
+
+double bytes_per_and(output_format format, bool compact_xor) {
+  switch (format) {
+    case aig_format: return 2.6;
+    case aag_format: return 21.3;
+    case cnf_format: return compact_xor ? 46.2 : 57;
+  }
+  return 0;
+}
+
+/*------------------------------------------------------------------------*/
+
+double predicted_memory(unsigned width, const memory_options & options) {
+  bool binary = options.reencode || options.buffered_archive;
+  bool cnf = 0;
+  double buffered = 0;
+  for (size_t i = 0; i < options.formats.size(); i++) {
+    output_format format = options.formats[i];
+    if (format == aig_format) binary = 1;
+    if (format == cnf_format) cnf = 1;
+    if (options.buffered)
+      buffered += bytes_per_and(format, options.compact_xor);
+  }
+  if (options.buffered_archive)
+    buffered += bytes_per_and(aig_format, 0);
+
+  double per_and = model_bytes + buffered;
+  if (binary) per_and += reencode_bytes;
+  if (cnf && options.compact_xor) per_and += xor_bytes;
+  if (options.simulation_words)
+    per_and += layout_bytes + simulation_bytes * options.simulation_words *
+               std::max(options.simulation_arrays, 1u);
+  if (options.live_check) per_and += 2 * simulation_bytes;  // growth slack
+
+  double ands = expected_ands(width, options.use_cl);
+  ands += miter_ands(width, options);
+  return job_bytes + per_and * ands;
+}
+
+/*------------------------------------------------------------------------*/
+
+/**
+    Path of the calibration file, empty without home directory
+*/
+static std::string calibration_path() {
+  const char * home = getenv("HOME");
+  if (!home) return "";
+  return std::string(home) + "/" + calibration_file;
+}
+
+/**
+    Host name of this machine, calibrations are stored per host
+*/
+static std::string host_name() {
+  char name[HOST_NAME_MAX + 1];
+  if (gethostname(name, sizeof name)) return "localhost";
+  name[HOST_NAME_MAX] = 0;
+  return name;
+}
+
+/*------------------------------------------------------------------------*/
+
+/**
+    Reads the seconds per unit of 'predicted_cost' of this host
+
+    @return 0 if this host is not calibrated
+*/
+static double calibrated_throughput() {
+  std::string path = calibration_path();
+  FILE * file = path.empty() ? 0 : fopen(path.c_str(), "r");
+  if (!file) return 0;
+
+  std::string host = host_name();
+  char name[256];
+  double seconds, res = 0;
+  while (fscanf(file, "%255s %lf", name, &seconds) == 2)
+    if (host == name) res = seconds;
+  fclose(file);
+  return res;
+}
+
+/*------------------------------------------------------------------------*/
+
+void calibrate_throughput() {
+  msg(1, "Calibration");
+  msg(1, "==========================================================");
+
+  output_targets targets;
+  targets.names.push_back("/dev/null");
+  targets.arch = 0;
+  targets.archive_sink = 0;
+  targets.records = 0;
+  targets.async = 0;
+  targets.mapped = 0;
+
+  int level = verbose;
+  double cost = 0, seconds = 0;
+  for (unsigned i = 0; i < sizeof calibration_widths / sizeof(unsigned);
+       i++) {
+    unsigned width = calibration_widths[i];
+    verbose = 0;
+    double start = thread_time();
+    seed_fuzzer(width);
+    init_aig(width);
+    generate_fuzzed_mult(width, 1);
+    write_fuzzed_model(targets, 0, 0);
+    reset_aig();
+    double used = thread_time() - start;
+    verbose = level;
+
+    msg(1, "  Width %4u:  %8.2f seconds", width, used);
+    cost += predicted_cost(width);
+    seconds += used;
+  }
+  release_aig_memory();
+  reset_sink_buffers();
+
+  double throughput = seconds / cost;
+  std::string host = host_name();
+  msg(1, "  Throughput:   %10.3e seconds per unit on '%s'", throughput,
+    host.c_str());
+
+  // keep the calibrations of other hosts
+  std::string path = calibration_path();
+  if (path.empty()) die(calibration_error, "no home directory for calibration");
+  std::vector<std::string> lines;
+  if (FILE * file = fopen(path.c_str(), "r")) {
+    char name[256];
+    double other;
+    while (fscanf(file, "%255s %lf", name, &other) == 2)
+      if (host != name) lines.push_back(std::string(name) + " " +
+                                        std::to_string(other));
+    fclose(file);
+  }
+  FILE * file = fopen(path.c_str(), "w");
+  if (!file) die(calibration_error, "can not write calibration '%s'",
+                 path.c_str());
+  for (size_t i = 0; i < lines.size(); i++)
+    fprintf(file, "%s\n", lines[i].c_str());
+  fprintf(file, "%s %.6e\n", host.c_str(), throughput);
+  fclose(file);
+  msg(1, "  Stored in '%s'", path.c_str());
+  msg(1, "");
+}
+
+/*------------------------------------------------------------------------*/
+
+void print_estimate(const std::vector<unsigned> & widths, unsigned count,
+                    unsigned threads, const memory_options & options) {
+  double throughput = calibrated_throughput();
+  bool calibrated = throughput > 0;
+  if (!calibrated) throughput = default_throughput;
+
+  msg(1, "Estimate");
+  msg(1, "==========================================================");
+  msg(1, "  %7s %13s %13s %12s %10s %10s %9s", "width", "gates",
+    "worst case", "max literal", "aig MB", "memory MB", "seconds");
+
+  double gates = 0, bytes = 0, memory = 0, seconds = 0, literal = 0;
+  for (size_t i = 0; i < widths.size(); i++) {
+    unsigned width = widths[i];
+    double expected = expected_ands(width, options.use_cl);
+    double worst = worst_case_ands(width, options.use_cl);
+    double time = throughput * predicted_cost(width);
+    if (options.fuzzed_miter) {
+      worst += worst_case_ands(width, options.use_cl) - expected;
+      time *= 2;
+    }
+    expected += miter_ands(width, options);
+    worst += miter_ands(width, options);
+    double max_literal = 2 * (2.0 * width + worst) + 1;
+    double size = binary_size(width, expected);
+    double peak = predicted_memory(width, options);
+
+    msg(1, "  %7u %13.0f %13.0f %12.0f %10.1f %10.1f %9.2f", width, expected,
+      worst, max_literal, size / (1 << 20), peak / (1 << 20), time);
+
+    gates += count * expected;
+    bytes += count * size;
+    seconds += count * time;
+    if (peak > memory) memory = peak;
+    if (max_literal > literal) literal = max_literal;
+  }
+
+  msg(1, "");
+  msg(1, "  Instances:       %zu", widths.size() * count);
+  msg(1, "  Gates:           %.0f", gates);
+  msg(1, "  Literals:        0 .. %.0f (%.0f bits)", literal,
+    ceil(log2(literal + 1)));
+  if (literal > UINT_MAX)
+    msg(1, "  Literals exceed the 32-bit literals of the aiger library");
+  msg(1, "  Binary AIGER:    %.1f MB", bytes / (1 << 20));
+  msg(1, "  Peak memory:     %.1f MB per thread", memory / (1 << 20));
+  msg(1, "  Time:            %.2f seconds on %u threads%s", seconds / threads,
+    threads, calibrated ? "" : " (not calibrated, run '--calibrate')");
+  msg(1, "");
+}
+/*------------------------------------------------------------------------*/
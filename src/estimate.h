@@ -0,0 +1,150 @@
+/*------------------------------------------------------------------------*/
+/*! \file estimate.h
+    \brief contains the cost model of generated multipliers
+
+  Predicts the number of gates, the file size, the peak memory and the time
+  of generating and writing a multiplier from its width and the output
+  options, without generating it.
+
+  The structure of the multiplier is fixed: n^2 partial products are
+  reduced by full and half adders chosen 2:1 in 'fuzz_ppa', each full
+  adder removes one bit. Hence there are about n^2 full adders with 9
+  gates on average and n^2/2 half adders with 3.5 gates, in total
+  11.75 n^2 gates. The linear term is fitted to the bits left for the
+  final stage adder. The deviation follows from the number of half adders,
+  which is negative binomially distributed, and the choice of the adder
+  types. Carry-lookahead adders add a heavy tail, their size is about
+  geometrically distributed and their gates are cubic in the size.
+
+  The byte costs per gate are measured on the aiger library used by the
+  fuzzer, the time is calibrated per machine with '--calibrate'.
+
+  Part of MultAIGenFuzzer: Generation-Based AIG Fuzzer for Multipliers
+  Copyright(C) 2022 Daniela Kaufmann, Johannes Kepler University Linz
+*/
+/*------------------------------------------------------------------------*/
+#ifndef AIGENFUZZER_SRC_ESTIMATE_H_
+#define AIGENFUZZER_SRC_ESTIMATE_H_
+/*------------------------------------------------------------------------*/
+#include <vector>
+
+#include "writer.h"
+/*------------------------------------------------------------------------*/
+
+/**
+    Options of an instance which influence its memory
+*/
+struct memory_options {
+  std::vector<output_format> formats;  // /< formats of the written files
+  bool use_cl;                         // /< carry-lookahead adders
+  bool reencode;                       // /< '-r' given
+  bool compact_xor;                    // /< XOR detection for CNF
+  bool buffered;                       // /< files are kept in memory
+                                       //    until written (asynchronous)
+  bool buffered_archive;               // /< archive entry kept in memory
+  unsigned simulation_words;           // /< words per variable of the
+                                       //    check by simulation, 0 without
+  unsigned simulation_arrays;          // /< value arrays of the check
+  bool live_check;                     // /< one word per variable
+                                       //    simulated while generating
+  bool miter;                          // /< miter with a reference
+                                       //    array multiplier
+  bool fuzzed_miter;                   // /< miter with a second fuzzed
+                                       //    multiplier
+};
+
+/**
+    Expected number of AND gates of a multiplier
+
+    @param width input bit-width
+    @param use_cl carry-lookahead adders
+
+    @return double
+*/
+double expected_ands(unsigned width, bool use_cl);
+
+/**
+    Standard deviation of the number of AND gates of a multiplier
+
+    @param width input bit-width
+
+    @return double
+*/
+double deviation_ands(unsigned width);
+
+/**
+    Number of AND gates exceeded with a probability below 10^-9, six
+    standard deviations above the expected number, with carry-lookahead
+    adders plus a large adder with iterative carries
+
+    @param width input bit-width
+    @param use_cl carry-lookahead adders
+
+    @return double
+*/
+double worst_case_ands(unsigned width, bool use_cl);
+
+/**
+    Expected number of AND gates added by the miter of 'options', 0
+    without: the reference array multiplier with n^2 partial products and
+    'n - 1' rows of one half adder and 'n - 1' full adders, except for one
+    half adder in the first row, or a second fuzzed multiplier, and the
+    XOR and OR gates comparing the products
+
+    @param width input bit-width
+    @param options memory_options
+
+    @return double
+*/
+double miter_ands(unsigned width, const memory_options & options);
+
+/**
+    Expected size of the binary AIGER file of a multiplier
+
+    @param width input bit-width
+    @param ands number of AND gates
+
+    @return bytes
+*/
+double binary_size(unsigned width, double ands);
+
+/**
+    Expected number of bytes per AND gate of a file in 'format'
+
+    @param format output_format
+    @param compact_xor XOR detection for CNF
+
+    @return double
+*/
+double bytes_per_and(output_format format, bool compact_xor);
+
+/**
+    Predicts the peak memory of generating and writing one multiplier
+
+    @param width input bit-width
+    @param options memory_options
+
+    @return bytes
+*/
+double predicted_memory(unsigned width, const memory_options & options);
+
+/**
+    Measures the time of generating and writing multipliers on this machine
+    and stores the seconds per unit of 'predicted_cost' for the host name
+    in the calibration file in the home directory
+*/
+void calibrate_throughput();
+
+/**
+    Prints gates, literal range, binary file size, peak memory and time of
+    'count' instances of each width without generating them
+
+    @param widths input bit-widths
+    @param count number of instances per width
+    @param threads number of worker threads
+    @param options memory_options
+*/
+void print_estimate(const std::vector<unsigned> & widths, unsigned count,
+                    unsigned threads, const memory_options & options);
+
+#endif  // AIGENFUZZER_SRC_ESTIMATE_H_
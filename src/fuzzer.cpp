@@ -7,10 +7,33 @@
 */
 /*------------------------------------------------------------------------*/
 #include "fuzzer.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "simulate.h"
 /*------------------------------------------------------------------------*/
-static std::vector<std::vector<unsigned>> slices;
+static thread_local std::vector<std::vector<unsigned>> slices;
+
+// / state of the random generator of the thread, 128 bytes as 'srand'
+static thread_local random_data rng;
+static thread_local char rng_state[128];
+
+// / live check: one word of 64 random patterns per variable, simulated
+// / while the gates are added
+static thread_local bool live_check;
+static thread_local uint64_t live_seed;
+static thread_local std::vector<uint64_t> live_words;    // /< per variable
+static thread_local std::vector<uint64_t> live_product;  // /< per output
+
+// / miter: the outputs of the multipliers are collected instead of being
+// / added to the model
+static thread_local bool collect_outputs;
+static thread_local std::vector<unsigned> collected;
+
 static unsigned error_fsa_empty = 31;
 static unsigned error_fsa_size = 32;
+static unsigned check_error = 51;
 /*------------------------------------------------------------------------*/
 static void print_slices(){
   int i = 0;
@@ -25,42 +48,144 @@ static void print_slices(){
   }
 }
 
+/*------------------------------------------------------------------------*/
+void seed_fuzzer(unsigned seed){
+  memset(&rng, 0, sizeof rng);
+  initstate_r(seed, rng_state, sizeof rng_state, &rng);
+}
+
+/*------------------------------------------------------------------------*/
+void set_live_check(bool enabled, uint64_t seed){
+  live_check = enabled;
+  live_seed = seed;
+}
+
+/*------------------------------------------------------------------------*/
+/**
+    Sets the words of the inputs to random patterns and computes the
+    expected words of the outputs
+*/
+static void init_live_check(unsigned size){
+  uint64_t state = live_seed;
+  live_words.assign(2*size + 1, 0);
+  for (unsigned i = 1; i <= 2*size; i++) live_words[i] = next_random(&state);
+  live_product.resize(2*size);
+  reference_product(size, &live_words[1], &live_words[size+1],
+                    &live_product[0], 1);
+}
+
+/*------------------------------------------------------------------------*/
+/**
+    Word of the literal 'lit' in the live check
+*/
+static inline uint64_t live_word(unsigned lit){
+  return live_words[lit >> 1] ^ -static_cast<uint64_t>(lit & 1);
+}
+
+/*------------------------------------------------------------------------*/
+/**
+    Prefetches the word of 'lit' for the live check. The inputs of the
+    cells are taken from random columns and their words are rarely cached,
+    prefetching when they are taken hides the latency behind the removal
+    from their slice.
+*/
+static inline void prefetch_live(unsigned lit){
+  if (live_check && (lit >> 1) < live_words.size())
+    __builtin_prefetch(&live_words[lit >> 1]);
+}
+
+/*------------------------------------------------------------------------*/
+/**
+    Adds the gate 'lhs' = 'rhs0' & 'rhs1', all gates of the multiplier are
+    added here, and simulates it for the live check
+*/
+static inline void add_and(unsigned lhs, unsigned rhs0, unsigned rhs1){
+  aiger_add_and(model, lhs, rhs0, rhs1);
+  if (!live_check) return;
+  unsigned var = lhs >> 1;
+  if (var >= live_words.size()) live_words.resize(var + 1);
+  live_words[var] = live_word(rhs0) & live_word(rhs1);
+}
+
+/*------------------------------------------------------------------------*/
+/**
+    Dies with the counterexample of the live check 'pattern', output 'name'
+    is 'value' instead of 'expected'
+*/
+static void report_live_counterexample(unsigned pattern, const char * name,
+                                       int value, int expected){
+  unsigned size = model->num_inputs / 2;
+  die(check_error, "generated multiplier is wrong for input\n"
+    "         a = 0x%s\n         b = 0x%s\n"
+    "         expected product 0x%s\n         output %s is %d instead of %d",
+    pattern_hex(&live_words[1], size, 1, pattern).c_str(),
+    pattern_hex(&live_words[size+1], size, 1, pattern).c_str(),
+    pattern_hex(&live_product[0], 2*size, 1, pattern).c_str(), name,
+    value, expected);
+}
+
+/*------------------------------------------------------------------------*/
+/**
+    Adds the next output 'lit' and compares its word with the product for
+    the live check, the check is complete with the last output. The outputs
+    of the multipliers of a miter are only collected.
+*/
+static void add_output(unsigned lit, const char * name){
+  unsigned k;
+  if (collect_outputs) {
+    k = collected.size();
+    collected.push_back(lit);
+  } else {
+    k = model->num_outputs;
+    aiger_add_output(model, lit, name);
+  }
+  if (!live_check) return;
+  uint64_t diff = live_word(lit) ^ live_product[k];
+  if (!diff) return;
+  unsigned pattern = __builtin_ctzll(diff);
+  report_live_counterexample(pattern, name,
+    static_cast<int>((live_word(lit) >> pattern) & 1),
+    static_cast<int>((live_product[k] >> pattern) & 1));
+}
+
 /*------------------------------------------------------------------------*/
 int rangeRandomZeroMax (int max){
     if(!max) return 0;
     int n = max;
     int remainder = RAND_MAX % n;
-    int x;
+    int32_t x;
     do{
-        x = rand();
+        random_r(&rng, &x);  // same sequence as 'rand' after 'srand'
     }while (x >= RAND_MAX - remainder);
     return x % n;
 }
 
 /*------------------------------------------------------------------------*/
 static void fuzz_pp(unsigned size){
+  // slices are reused from the previous multiplier to keep their memory
+  slices.resize(2*size);
+  for(unsigned s = 0; s < 2*size; s++) slices[s].clear();
+
   idx++;
   for(unsigned s = 0; s < size; s++){
-    std::vector<unsigned> sl;
+    std::vector<unsigned> & sl = slices[s];
     for(unsigned i = 0; i <= s; i++){
       int j = s - i;
-      aiger_add_and(model, 2*idx, 2*(i+1), 2*(j+1+size));
+      add_and(2*idx, 2*(i+1), 2*(j+1+size));
 
       sl.push_back(2*idx);
       idx++;
     }
-    slices.push_back(sl);
   }
 
   for(unsigned s = 0; s < size; s++){
-    std::vector<unsigned> sl;
+    std::vector<unsigned> & sl = slices[size+s];
     for(unsigned i = s+1; i < size; i++){
       int j = size + s - i;
-      aiger_add_and(model, 2*idx, 2*(i+1), 2*(j+1+size));
+      add_and(2*idx, 2*(i+1), 2*(j+1+size));
       sl.push_back(2*idx);
       idx++;
     }
-    slices.push_back(sl);
   }
 }
 
@@ -74,14 +199,14 @@ static void generate_a_ha
   unsigned g4 = 2*idx + 8;
 
 
-  aiger_add_and(model, g1, a^1,  b);
-  aiger_add_and(model, g2, a,    b^1);
-  aiger_add_and(model, g3, g1^1, g2^1); //sum
+  add_and(g1, a^1,  b);
+  add_and(g2, a,    b^1);
+  add_and(g3, g1^1, g2^1); //sum
   slices[sel_sl].push_back(g3^1);
 
 
   if(sel_sl < 2*size-1) {
-    aiger_add_and(model, g4, a,  b);
+    add_and(g4, a,  b);
     msg(3,"      slice %i A-HA %i %i %i %i ", sel_sl, g4^1, g3^1, a,b);
     slices[sel_sl+1].push_back(g4);
     idx = idx + 4;
@@ -99,9 +224,9 @@ static void generate_b_ha
   unsigned three = 2*idx + 6;
 
 
-  aiger_add_and(model, one,   a^1,    b^1);
-  aiger_add_and(model, two,   a,      b);     //carry
-  aiger_add_and(model, three, one^1,  two^1); //sum
+  add_and(one,   a^1,    b^1);
+  add_and(two,   a,      b);     //carry
+  add_and(three, one^1,  two^1); //sum
   slices[sel_sl].push_back(three);
 
 
@@ -140,21 +265,21 @@ static void generate_a_fa
   unsigned g10 = 2*idx + 20;
   unsigned g11 = 2*idx + 22;
 
-  aiger_add_and(model, g1, a,     b^1);
-  aiger_add_and(model, g2, b,     a^1);
-  aiger_add_and(model, g3, g1^1,  g2^1);
-  aiger_add_and(model, g4, g3^1,  c^1);
-  aiger_add_and(model, g5, g3,    c);
-  aiger_add_and(model, g6, g4^1,  g5^1); // sum
+  add_and(g1, a,     b^1);
+  add_and(g2, b,     a^1);
+  add_and(g3, g1^1,  g2^1);
+  add_and(g4, g3^1,  c^1);
+  add_and(g5, g3,    c);
+  add_and(g6, g4^1,  g5^1); // sum
 
   slices[sel_sl].push_back(g6^1);
 
   if(sel_sl < 2*size-1) {
-    aiger_add_and(model, g7, a,     b);
-    aiger_add_and(model, g8, a,     c);
-    aiger_add_and(model, g9, b,     c);
-    aiger_add_and(model, g10, g7^1, g8^1);
-    aiger_add_and(model, g11, g10,  g9^1);  //carry
+    add_and(g7, a,     b);
+    add_and(g8, a,     c);
+    add_and(g9, b,     c);
+    add_and(g10, g7^1, g8^1);
+    add_and(g11, g10,  g9^1);  //carry
     msg(3,"      slice %i A-FA %i %i %i %i %i", sel_sl, g11^1, g6^1, a,b,c);
     slices[sel_sl+1].push_back(g11^1);
     idx = idx + 11;
@@ -176,17 +301,17 @@ static void generate_b_fa
   unsigned six   = 2*idx + 12;
   unsigned seven = 2*idx + 14;
 
-  aiger_add_and(model, one,   a^1,    b^1);
-  aiger_add_and(model, two,   a,      b);
-  aiger_add_and(model, three, one^1,  two^1);
-  aiger_add_and(model, four,  c^1,    three^1);
-  aiger_add_and(model, five,  c,      three);
-  aiger_add_and(model, six,   four^1, five^1);  //sum
+  add_and(one,   a^1,    b^1);
+  add_and(two,   a,      b);
+  add_and(three, one^1,  two^1);
+  add_and(four,  c^1,    three^1);
+  add_and(five,  c,      three);
+  add_and(six,   four^1, five^1);  //sum
   slices[sel_sl].push_back(six);
 
 
   if(sel_sl < 2*size-1) {
-    aiger_add_and(model, seven, two^1,    five^1);  //carry
+    add_and(seven, two^1,    five^1);  //carry
     msg(3,"      slice %i B-FA %i %i %i %i %i", sel_sl, seven^1, six, a,b,c);
     slices[sel_sl+1].push_back(seven^1);
     idx = idx + 7;
@@ -212,9 +337,9 @@ static unsigned gen_xor (unsigned a, unsigned b){
   unsigned g2 = 2*idx + 4;
   unsigned g3 = 2*idx + 6;
 
-  aiger_add_and(model, g1, a^1,    b);
-  aiger_add_and(model, g2, a,      b^1);
-  aiger_add_and(model, g3, g1^1,   g2^1);
+  add_and(g1, a^1,    b);
+  add_and(g2, a,      b^1);
+  add_and(g3, g1^1,   g2^1);
   idx = idx +3;
 
   return g3^1;
@@ -223,7 +348,7 @@ static unsigned gen_xor (unsigned a, unsigned b){
 /*------------------------------------------------------------------------*/
 static unsigned gen_and (unsigned a, unsigned b){
   unsigned g1 = 2*idx + 2;
-  aiger_add_and(model, g1, a,    b);
+  add_and(g1, a,    b);
   idx = idx +1;
   return g1;
 
@@ -232,7 +357,7 @@ static unsigned gen_and (unsigned a, unsigned b){
 /*------------------------------------------------------------------------*/
 static unsigned gen_or (unsigned a, unsigned b){
   unsigned g1 = 2*idx + 2;
-  aiger_add_and(model, g1, a^1,    b^1);
+  add_and(g1, a^1,    b^1);
   idx = idx +1;
   return g1^1;
 }
@@ -240,8 +365,8 @@ static unsigned gen_or (unsigned a, unsigned b){
 static unsigned gen_cla_recursive_carry(unsigned c, unsigned p, unsigned g){
   unsigned g1 = 2*idx + 2;
   unsigned g2 = 2*idx + 4;
-  aiger_add_and(model, g1, c, p);
-  aiger_add_and(model, g2, g1^1, g^1);
+  add_and(g1, c, p);
+  add_and(g2, g1^1, g^1);
   idx = idx +2;
   return g2^1;
 }
@@ -321,7 +446,7 @@ static int generate_cla (int id, int size){
     } else die(3, "error %i", iterative_recursive_mixed);
 
     std::string s = "o" + std::to_string(id+i);
-    aiger_add_output(model, out, s.c_str());
+    add_output(out, s.c_str());
     msg(3,"    Output %i %s", out, s.c_str());
 
   }
@@ -349,16 +474,19 @@ static void fuzz_ppa(int size){
 
     int a_idx = rangeRandomZeroMax(rand_sl_size);
     unsigned a = slices[sel_sl][a_idx];
+    prefetch_live(a);
     slices[sel_sl].erase(slices[sel_sl].begin() + a_idx);
 
     int b_idx = rangeRandomZeroMax(--rand_sl_size);
     unsigned b = slices[sel_sl][b_idx];
+    prefetch_live(b);
     slices[sel_sl].erase(slices[sel_sl].begin() + b_idx);
 
     if(!rangeRandomZeroMax(3)) generate_ha(a,b,sel_sl, size);
     else {
       int c_idx = rangeRandomZeroMax(--rand_sl_size);
       unsigned c = slices[sel_sl][c_idx];
+      prefetch_live(c);
       slices[sel_sl].erase(slices[sel_sl].begin() + c_idx);
 
       generate_fa(a,b,c, sel_sl, size);
@@ -388,12 +516,12 @@ static void fuzz_fsa(int size, bool use_cl){
     if(si_size == 0){
       die(error_fsa_empty, "Slice %i for FSA fuzzing is empty", i);
     } else if(si_size == 1){
-      aiger_add_output(model, slices[i][0], s.c_str());
+      add_output(slices[i][0], s.c_str());
       msg(3,"    Output %i %s", slices[i][0], s.c_str());
 
     } else if (si_size == 2){
       generate_ha(slices[i][0], slices[i][1], i, size);
-      aiger_add_output(model, slices[i][2], s.c_str());
+      add_output(slices[i][2], s.c_str());
       msg(3,"    Output %i %s", slices[i][2], s.c_str());
 
     } else if (si_size == 3 && use_cl && i < 2*size-1){
@@ -406,13 +534,13 @@ static void fuzz_fsa(int size, bool use_cl){
       if(r && cla) {i += cla-1;    //increase slices if CLA is success
       } else {
         generate_fa(slices[i][0], slices[i][1], slices[i][2], i, size);
-        aiger_add_output(model, slices[i][3], s.c_str());
+        add_output(slices[i][3], s.c_str());
         msg(3,"    Output %i %s", slices[i][3], s.c_str());
       }
     } else if (si_size == 3){
 
       generate_fa(slices[i][0], slices[i][1], slices[i][2], i, size);
-      aiger_add_output(model, slices[i][3], s.c_str());
+      add_output(slices[i][3], s.c_str());
       msg(3,"    Output %i %s", slices[i][3], s.c_str());
 
     } else die(error_fsa_size, "Slice %i is too large for FSA fuzzing", i);
@@ -421,8 +549,120 @@ static void fuzz_fsa(int size, bool use_cl){
 
 /*------------------------------------------------------------------------*/
 
-void generate_fuzzed_mult(int size, bool use_cl){
+/**
+    Adds the gates of a fuzzed multiplier
+*/
+static void fuzz_mult(int size, bool use_cl){
   fuzz_pp(size);
   fuzz_ppa(size);
   fuzz_fsa(size, use_cl);
 }
+
+/*------------------------------------------------------------------------*/
+
+void generate_fuzzed_mult(int size, bool use_cl){
+  if (live_check) init_live_check(size);
+  fuzz_mult(size, use_cl);
+}
+
+/*------------------------------------------------------------------------*/
+/**
+    Adds a half adder of the reference multiplier, returns the sum and sets
+    'carry'
+*/
+static unsigned gen_half_adder(unsigned a, unsigned b, unsigned * carry){
+  unsigned sum = gen_xor(a, b);
+  *carry = gen_and(a, b);
+  return sum;
+}
+
+/*------------------------------------------------------------------------*/
+/**
+    Adds a full adder of the reference multiplier, returns the sum and sets
+    'carry'. The gates are added one by one, the order of evaluating
+    arguments would make the numbering depend on the compiler.
+*/
+static unsigned gen_full_adder(unsigned a, unsigned b, unsigned c,
+                               unsigned * carry){
+  unsigned p = gen_xor(a, b);
+  unsigned sum = gen_xor(p, c);
+  unsigned g = gen_and(a, b);
+  unsigned t = gen_and(p, c);
+  *carry = gen_or(g, t);
+  return sum;
+}
+
+/*------------------------------------------------------------------------*/
+/**
+    Adds a plain array multiplier over the inputs: row 'j' adds the partial
+    products 'a_i & b_j' to the bits 'j' to 'j + n - 1' of the sum of the
+    rows before by a ripple-carry adder, its carry is bit 'j + n'
+*/
+static void generate_array_mult(int size, std::vector<unsigned> * product){
+  std::vector<unsigned> & p = *product;
+  p.assign(2*size, aiger_false);
+  for (int i = 0; i < size; i++) p[i] = gen_and(2*(i+1), 2*(size+1));
+
+  for (int j = 1; j < size; j++){
+    unsigned carry = aiger_false;
+    for (int i = 0; i < size; i++){
+      unsigned pp = gen_and(2*(i+1), 2*(size+j+1));
+      if (!i) p[j] = gen_half_adder(p[j], pp, &carry);
+      else if (i == size-1 && j == 1)
+        p[size] = gen_half_adder(pp, carry, &carry);  // bit n is still 0
+      else p[i+j] = gen_full_adder(p[i+j], pp, carry, &carry);
+    }
+    p[size+j] = carry;
+  }
+  msg(2,"  Generated reference array multiplier");
+}
+
+/*------------------------------------------------------------------------*/
+/**
+    Adds the miter of the products 'x' and 'y' as only output, the OR of
+    the XORs of their bits, and checks that it is 0 for the live check
+*/
+static void add_miter(const std::vector<unsigned> & x,
+                      const std::vector<unsigned> & y){
+  unsigned miter = gen_xor(x[0], y[0]);
+  for (size_t k = 1; k < x.size(); k++){
+    unsigned diff = gen_xor(x[k], y[k]);
+    miter = gen_or(miter, diff);
+  }
+  aiger_add_output(model, miter, "miter");
+  msg(3,"    Output %i miter", miter);
+
+  if (!live_check || !live_word(miter)) return;
+  report_live_counterexample(__builtin_ctzll(live_word(miter)), "miter",
+                             1, 0);
+}
+
+/*------------------------------------------------------------------------*/
+
+void generate_reference_miter(int size, bool use_cl){
+  collect_outputs = 1;
+  collected.clear();
+  generate_fuzzed_mult(size, use_cl);
+  collect_outputs = 0;
+
+  std::vector<unsigned> reference;
+  generate_array_mult(size, &reference);
+  add_miter(collected, reference);
+}
+
+/*------------------------------------------------------------------------*/
+
+void generate_fuzzed_miter(int size, bool use_cl, unsigned seed){
+  if (live_check) init_live_check(size);
+  collect_outputs = 1;
+  collected.clear();
+  fuzz_mult(size, use_cl);
+  std::vector<unsigned> first;
+  first.swap(collected);
+
+  seed_fuzzer(seed);
+  fuzz_mult(size, use_cl);
+  collect_outputs = 0;
+  msg(2,"  Generated second fuzzed multiplier with seed %u", seed);
+  add_miter(first, collected);
+}
@@ -16,7 +16,49 @@
 
 // currently only SPP support
 
+/**
+    Seeds the random generator of the calling thread, the generated
+    numbers are the same as of 'rand' after 'srand(seed)'
+
+    @param seed seed of the multiplier
+*/
+void seed_fuzzer(unsigned seed);
+
+/**
+    Enables the live check of the multipliers generated by the calling
+    thread: every gate is simulated on one word of 64 random patterns when
+    it is added, and every output is compared with the product of the
+    inputs when it is added. A wrong output stops the run with a
+    counterexample, with the last output the check is complete without
+    another pass over the gates.
+
+    @param enabled enables the live check
+    @param seed seed of the patterns
+*/
+void set_live_check(bool enabled, uint64_t seed);
 
 void generate_fuzzed_mult(int size, bool use_cl);
 
+/**
+    Generates a fuzzed multiplier and a plain array multiplier over the
+    same inputs, whose products are not outputs of the model. The only
+    output 'miter' is the OR of the XORs of the bits of the products, it is
+    1 iff the multipliers differ.
+
+    @param size input bit-width
+    @param use_cl carry-lookahead adders in the fuzzed multiplier
+*/
+void generate_reference_miter(int size, bool use_cl);
+
+/**
+    Generates two fuzzed multipliers over the same inputs, the first with
+    the seed of 'seed_fuzzer', the second with 'seed', and adds the miter of
+    their products as only output 'miter'
+
+    @param size input bit-width
+    @param use_cl carry-lookahead adders
+    @param seed seed of the second multiplier
+*/
+void generate_fuzzed_miter(int size, bool use_cl, unsigned seed);
+
 #endif  // AIGENFUZZER_SRC_FUZZER_H_
@@ -0,0 +1,312 @@
+/*------------------------------------------------------------------------*/
+/*! \file manifest.cpp
+    \brief contains manifests listing the generated instances of a batch
+
+  Part of MultAIGenFuzzer: Generation-Based AIG Fuzzer for Multipliers
+  Copyright(C) 2022 Daniela Kaufmann, Johannes Kepler University Linz
+*/
+/*------------------------------------------------------------------------*/
+#include "manifest.h"
+
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <mutex>
+
+#include <unistd.h>
+/*------------------------------------------------------------------------*/
+// Local Variables
+
+static const char * manifest_magic = "# multaigenfuzzer manifest";
+static const char * manifest_columns =
+  "# width seed options index ands seconds bytes checksum fingerprint file";
+
+static unsigned manifest_error = 23;
+
+static std::mutex manifest_mutex;  // /< protects the records of manifests
+/*------------------------------------------------------------------------*/
+
+static bool record_less(const manifest_record & a,
+                        const manifest_record & b) {
+  if (a.key.width != b.key.width) return a.key.width < b.key.width;
+  if (a.key.seed != b.key.seed) return a.key.seed < b.key.seed;
+  if (a.key.options != b.key.options) return a.key.options < b.key.options;
+  return a.file < b.file;
+}
+
+/*------------------------------------------------------------------------*/
+
+static bool same_file(const manifest_record & a, const manifest_record & b) {
+  return !record_less(a, b) && !record_less(b, a);
+}
+
+/*------------------------------------------------------------------------*/
+
+void init_manifest(manifest * man, const char * name,
+                   unsigned shard, unsigned shards) {
+  man->name = name;
+  man->shard = shard;
+  man->shards = shards;
+  man->records.clear();
+  man->journal = 0;
+}
+
+/*------------------------------------------------------------------------*/
+
+static std::string journal_name(const manifest * man) {
+  return std::string(man->name) + ".journal";
+}
+
+/*------------------------------------------------------------------------*/
+
+static void write_record(FILE * file, const manifest_record & r) {
+  fprintf(file, "%u %llu %u %u %u %.6f %llu %016llx %016llx %s\n",
+    r.key.width, static_cast<unsigned long long>(r.key.seed),
+    r.key.options, r.index, r.ands, r.seconds,
+    static_cast<unsigned long long>(r.bytes),
+    static_cast<unsigned long long>(r.checksum),
+    static_cast<unsigned long long>(r.fingerprint), r.file.c_str());
+}
+
+/*------------------------------------------------------------------------*/
+
+/**
+    Parses the record 'line', with fingerprint column if 'fingerprinted'
+
+    @return false if 'line' is invalid
+*/
+static bool parse_record(const char * line, manifest_record * r,
+                         bool fingerprinted) {
+  unsigned width, options;
+  unsigned long long seed, bytes, checksum, fingerprint = 0;
+  int columns = 0, file_start = 0;
+  if (sscanf(line, "%u %llu %u %u %u %lf %llu %llx %n", &width, &seed,
+             &options, &r->index, &r->ands, &r->seconds, &bytes, &checksum,
+             &columns) != 8)
+    return 0;
+  if (fingerprinted &&
+      sscanf(line + columns, "%llx %n", &fingerprint, &file_start) != 1)
+    return 0;
+  file_start += columns;
+  if (!line[file_start]) return 0;
+  r->key.width = width;
+  r->key.options = options;
+  r->key.seed = seed;
+  r->bytes = bytes;
+  r->checksum = checksum;
+  r->fingerprint = fingerprint;
+  r->file = line + file_start;
+  return 1;
+}
+
+/*------------------------------------------------------------------------*/
+
+/**
+    Reads the next line of 'file' into 'line' without newline
+
+    @return false at the end of the file
+*/
+static bool read_line(FILE * file, const char * name, char * line,
+                      size_t size, unsigned * lineno) {
+  if (!fgets(line, size, file)) return 0;
+  ++*lineno;
+  size_t len = strlen(line);
+  if (len && line[len - 1] == '\n') line[--len] = 0;
+  else if (!feof(file))
+    die(manifest_error, "line %u of manifest '%s' is too long",
+      *lineno, name);
+  return 1;
+}
+
+/*------------------------------------------------------------------------*/
+
+void open_manifest_journal(manifest * man) {
+  std::string name = journal_name(man);
+  man->journal = fopen(name.c_str(), "a");
+  if (!man->journal)
+    die(manifest_error, "can not write journal '%s'", name.c_str());
+}
+
+/*------------------------------------------------------------------------*/
+
+void read_manifest_journal(manifest * man) {
+  std::string name = journal_name(man);
+  FILE * file = fopen(name.c_str(), "r");
+  if (!file) return;
+
+  char line[4096];
+  unsigned lineno = 0;
+  while (read_line(file, name.c_str(), line, sizeof line, &lineno)) {
+    manifest_record r;
+    // the last line is incomplete if the batch was killed while writing
+    if (!parse_record(line, &r, 1)) {
+      if (feof(file)) break;
+      die(manifest_error, "invalid line %u in journal '%s'", lineno,
+        name.c_str());
+    }
+    man->records.push_back(r);
+  }
+  fclose(file);
+}
+
+/*------------------------------------------------------------------------*/
+
+void add_manifest_records(manifest * man,
+                          const std::vector<manifest_record> & records) {
+  std::lock_guard<std::mutex> lock(manifest_mutex);
+  man->records.insert(man->records.end(), records.begin(), records.end());
+  if (!man->journal) return;
+  for (size_t i = 0; i < records.size(); i++)
+    write_record(man->journal, records[i]);
+  if (fflush(man->journal))
+    die(manifest_error, "failed to write journal of '%s'", man->name);
+}
+
+/*------------------------------------------------------------------------*/
+
+void write_manifest(manifest * man) {
+  std::sort(man->records.begin(), man->records.end(), record_less);
+  man->records.erase(std::unique(man->records.begin(), man->records.end(),
+                                 same_file), man->records.end());
+
+  // a crash leaves either the old or the new manifest
+  std::string tmp = std::string(man->name) + ".tmp";
+  FILE * file = fopen(tmp.c_str(), "w");
+  if (!file) die(manifest_error, "can not write manifest '%s'", tmp.c_str());
+
+  fprintf(file, "%s\n# shard %u/%u\n", manifest_magic, man->shard,
+    man->shards);
+  fprintf(file, "%s\n", manifest_columns);
+  for (size_t i = 0; i < man->records.size(); i++)
+    write_record(file, man->records[i]);
+  if (fflush(file) || fsync(fileno(file)) || fclose(file))
+    die(manifest_error, "failed to write manifest '%s'", tmp.c_str());
+  if (rename(tmp.c_str(), man->name))
+    die(manifest_error, "failed to replace manifest '%s'", man->name);
+
+  if (man->journal) {
+    fclose(man->journal);
+    man->journal = 0;
+    unlink(journal_name(man).c_str());
+  }
+
+  msg(1, "  Manifest '%s' lists %zu files", man->name, man->records.size());
+}
+
+/*------------------------------------------------------------------------*/
+
+void read_manifest(manifest * man, const char * name) {
+  FILE * file = fopen(name, "r");
+  if (!file) die(manifest_error, "can not read manifest '%s'", name);
+
+  char line[4096];
+  unsigned lineno = 0;
+  bool fingerprinted = 0;  // older manifests have no fingerprint column
+  while (read_line(file, name, line, sizeof line, &lineno)) {
+    if (lineno == 1 && strcmp(line, manifest_magic))
+      die(manifest_error, "'%s' is not a manifest", name);
+    if (line[0] == '#') {
+      sscanf(line, "# shard %u/%u", &man->shard, &man->shards);
+      if (!strcmp(line, manifest_columns)) fingerprinted = 1;
+      continue;
+    }
+
+    manifest_record r;
+    if (!parse_record(line, &r, fingerprinted))
+      die(manifest_error, "invalid line %u in manifest '%s'", lineno, name);
+    man->records.push_back(r);
+  }
+  fclose(file);
+}
+
+/*------------------------------------------------------------------------*/
+
+/**
+    Removes the records of instances whose fingerprint equals the one of an
+    instance with smaller key, records are sorted by key
+*/
+static void drop_duplicate_instances(manifest * man) {
+  std::map<uint64_t, archive_key> first;
+  std::vector<manifest_record> kept;
+  unsigned dropped = 0;
+  for (size_t i = 0; i < man->records.size(); i++) {
+    const manifest_record & r = man->records[i];
+    if (r.fingerprint) {
+      const archive_key & k =
+        first.insert(std::make_pair(r.fingerprint, r.key)).first->second;
+      if (k.width != r.key.width || k.seed != r.key.seed ||
+          k.options != r.key.options) {
+        // the files of an instance are adjacent, count it once
+        const manifest_record * last = i ? &man->records[i - 1] : 0;
+        if (!last || last->key.width != r.key.width ||
+            last->key.seed != r.key.seed || last->key.options != r.key.options)
+          dropped++;
+        continue;
+      }
+    }
+    kept.push_back(r);
+  }
+  man->records.swap(kept);
+  if (dropped)
+    msg(1, "  Dropped %u instances duplicating instances of other shards",
+      dropped);
+}
+
+/*------------------------------------------------------------------------*/
+
+void merge_manifests(const char * output,
+                     const std::vector<const char *> & inputs) {
+  manifest merged;
+  init_manifest(&merged, output, 0, 1);
+
+  // shards found per shard count, to report incomplete corpora
+  std::vector<bool> found;
+  unsigned shards = 0;
+  bool mixed = 0;
+
+  for (size_t i = 0; i < inputs.size(); i++) {
+    manifest man;
+    init_manifest(&man, inputs[i], 0, 1);
+    read_manifest(&man, inputs[i]);
+    msg(1, "  Read %zu records of shard %u/%u from '%s'",
+      man.records.size(), man.shard, man.shards, inputs[i]);
+
+    if (!shards) {
+      shards = man.shards;
+      found.assign(shards, 0);
+    } else if (man.shards != shards) {
+      mixed = 1;
+    }
+    if (!mixed && man.shard < shards) found[man.shard] = 1;
+
+    merged.records.insert(merged.records.end(),
+                          man.records.begin(), man.records.end());
+  }
+
+  std::sort(merged.records.begin(), merged.records.end(), record_less);
+  std::vector<manifest_record> unique;
+  for (size_t i = 0; i < merged.records.size(); i++) {
+    const manifest_record & r = merged.records[i];
+    if (!unique.empty() && same_file(unique.back(), r)) {
+      if (unique.back().checksum != r.checksum ||
+          unique.back().bytes != r.bytes)
+        die(manifest_error, "manifests list '%s' with different checksums",
+          r.file.c_str());
+      continue;
+    }
+    unique.push_back(r);
+  }
+  merged.records.swap(unique);
+  drop_duplicate_instances(&merged);
+
+  if (mixed) {
+    msg(1, "  Merged manifests of different shard counts");
+  } else {
+    unsigned missing = std::count(found.begin(), found.end(), false);
+    if (missing) msg(1, "  %u of %u shards are missing", missing, shards);
+    else msg(1, "  All %u shards are merged", shards);
+  }
+
+  write_manifest(&merged);
+}
+/*------------------------------------------------------------------------*/
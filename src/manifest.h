@@ -0,0 +1,127 @@
+/*------------------------------------------------------------------------*/
+/*! \file manifest.h
+    \brief contains manifests listing the generated instances of a batch
+
+  A manifest is a text file with one line per written file of an instance:
+
+    width seed options index ands seconds bytes checksum fingerprint file
+
+  The options are the bits of 'archive_options', the checksum is the
+  64-bit FNV-1a hash of the file in hexadecimal, the fingerprint is the
+  'model_fingerprint' of the instance in hexadecimal, an archive entry is
+  listed with the name of the archive. Manifests without fingerprint column
+  are still read, their fingerprints are 0. Comment lines start with '#',
+  the second line gives the shard 'i/k' of the batch. Records are sorted
+  by width, seed, options and file, hence manifests of shards can be
+  merged into one corpus index.
+
+  While a batch runs, the records of each finished instance are appended
+  to the journal 'name.journal'. The manifest itself is replaced
+  atomically by renaming a temporary file, afterwards the journal is
+  removed. An interrupted batch can be resumed from manifest and journal.
+
+  Part of MultAIGenFuzzer: Generation-Based AIG Fuzzer for Multipliers
+  Copyright(C) 2022 Daniela Kaufmann, Johannes Kepler University Linz
+*/
+/*------------------------------------------------------------------------*/
+#ifndef AIGENFUZZER_SRC_MANIFEST_H_
+#define AIGENFUZZER_SRC_MANIFEST_H_
+/*------------------------------------------------------------------------*/
+#include <string>
+#include <vector>
+
+#include "archive.h"
+/*------------------------------------------------------------------------*/
+
+/**
+    One written file of an instance
+*/
+struct manifest_record {
+  archive_key key;         // /< width, options and seed of the instance
+  unsigned index;          // /< index of the instance in the batch
+  unsigned ands;           // /< number of AND gates
+  double seconds;          // /< time used to generate and write
+  uint64_t bytes;          // /< size of the file
+  uint64_t checksum;       // /< checksum of the file
+  uint64_t fingerprint;    // /< fingerprint of the instance, 0 if unknown
+  std::string file;        // /< name of the file or archive
+};
+
+/**
+    Manifest of one shard, or of the merged corpus
+*/
+struct manifest {
+  const char * name;                     // /< name of manifest file
+  unsigned shard;                        // /< index of the shard
+  unsigned shards;                       // /< number of shards
+  std::vector<manifest_record> records;  // /< records
+  FILE * journal;                        // /< receives the records of each
+                                         //    instance, or 0
+};
+/*------------------------------------------------------------------------*/
+
+/**
+    Initializes an empty manifest
+
+    @param man manifest
+    @param name name of manifest file
+    @param shard index of the shard
+    @param shards number of shards
+*/
+void init_manifest(manifest * man, const char * name,
+                   unsigned shard, unsigned shards);
+
+/**
+    Opens the journal of 'man' for appending
+
+    @param man manifest
+*/
+void open_manifest_journal(manifest * man);
+
+/**
+    Appends the records of the journal of 'man', if it exists
+
+    @param man manifest
+*/
+void read_manifest_journal(manifest * man);
+
+/**
+    Adds the records of one instance and appends them to the journal, can be
+    called by several threads
+
+    @param man manifest
+    @param records records of the files of the instance
+*/
+void add_manifest_records(manifest * man,
+                          const std::vector<manifest_record> & records);
+
+/**
+    Sorts the records, removes duplicates, replaces the manifest file
+    atomically and removes the journal
+
+    @param man manifest
+*/
+void write_manifest(manifest * man);
+
+/**
+    Reads the manifest file 'name' and appends its records to 'man'.
+    Dies if the file can not be parsed.
+
+    @param man manifest
+    @param name name of manifest file
+*/
+void read_manifest(manifest * man, const char * name);
+
+/**
+    Merges the shard manifests 'inputs' into the manifest 'output'.
+    Dies if two manifests list the same file with different checksums.
+    Instances with the fingerprint of an instance with smaller key, which
+    other shards generated, are dropped from the merged manifest.
+
+    @param output name of merged manifest
+    @param inputs names of shard manifests
+*/
+void merge_manifests(const char * output,
+                     const std::vector<const char *> & inputs);
+
+#endif  // AIGENFUZZER_SRC_MANIFEST_H_
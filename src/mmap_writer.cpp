@@ -0,0 +1,192 @@
+/*------------------------------------------------------------------------*/
+/*! \file mmap_writer.cpp
+    \brief contains the memory-mapped writer for large binary AIGER files
+
+  Part of MultAIGenFuzzer: Generation-Based AIG Fuzzer for Multipliers
+  Copyright(C) 2022 Daniela Kaufmann, Johannes Kepler University Linz
+*/
+/*------------------------------------------------------------------------*/
+#include "mmap_writer.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+/*------------------------------------------------------------------------*/
+// Local Variables
+
+static unsigned writing_error = 21;
+
+static const unsigned min_chunk = 1 << 16;  // /< gates per encoding thread
+/*------------------------------------------------------------------------*/
+
+static unsigned delta_length(unsigned delta) {
+  unsigned res = 1;
+  while (delta & ~0x7f) {
+    delta >>= 7;
+    res++;
+  }
+  return res;
+}
+
+/*------------------------------------------------------------------------*/
+
+static unsigned char * encode_delta(unsigned char * p, unsigned delta) {
+  while (delta & ~0x7f) {
+    *p++ = (delta & 0x7f) | 0x80;
+    delta >>= 7;
+  }
+  *p++ = delta;
+  return p;
+}
+
+/*------------------------------------------------------------------------*/
+
+/**
+    Computes the number of bytes of the gates ['lower', 'upper')
+*/
+static size_t gates_size(const aiger_and * ands,
+                         unsigned lower, unsigned upper) {
+  size_t res = 0;
+  for (unsigned i = lower; i < upper; i++) {
+    const aiger_and * gate = ands + i;
+    res += delta_length(gate->lhs - gate->rhs0);
+    res += delta_length(gate->rhs0 - gate->rhs1);
+  }
+  return res;
+}
+
+/*------------------------------------------------------------------------*/
+
+static void encode_gates(unsigned char * p, const aiger_and * ands,
+                         unsigned lower, unsigned upper) {
+  for (unsigned i = lower; i < upper; i++) {
+    const aiger_and * gate = ands + i;
+    p = encode_delta(p, gate->lhs - gate->rhs0);
+    p = encode_delta(p, gate->rhs0 - gate->rhs1);
+  }
+}
+
+/*------------------------------------------------------------------------*/
+
+/**
+    Bounds the bytes of all gates. In a reencoded model the gate 'i' has
+    the left-hand side 2*(num_inputs+i+1) and both of its deltas are at
+    most as long as its left-hand side.
+*/
+static size_t gates_bound() {
+  uint64_t first = 2 * (static_cast<uint64_t>(model->num_inputs) + 1);
+  uint64_t last = first + 2 * static_cast<uint64_t>(model->num_ands);
+  size_t res = 0;
+  for (unsigned length = 1; first < last; length++) {
+    uint64_t limit = static_cast<uint64_t>(1) << (7 * length);
+    uint64_t upper = limit < last ? limit : last;
+    if (first < upper) {
+      res += 2 * length * ((upper - first + 1) / 2);
+      first = upper + (upper & 1);
+    }
+  }
+  return res;
+}
+
+/*------------------------------------------------------------------------*/
+
+/**
+    Returns the header (if 'header') or the symbol table of the model
+    as malloc'd buffer
+*/
+static char * model_section(const char * name, bool header, size_t * size) {
+  sink s;
+  init_memory_sink(&s, name, aig_format);
+  if (header) write_model_header(&s, 0);
+  else write_model_trailer(&s);
+  return take_sink_buffer(&s, size);
+}
+
+/*------------------------------------------------------------------------*/
+
+static void preallocate(int fd, const char * name, size_t size) {
+  if (!fallocate(fd, 0, 0, size)) return;
+  if (errno != EOPNOTSUPP && errno != ENOSYS)
+    die(writing_error, "can not allocate %zu bytes for '%s'", size, name);
+  if (ftruncate(fd, size))
+    die(writing_error, "can not resize '%s'", name);
+}
+
+/*------------------------------------------------------------------------*/
+
+size_t write_mapped_aig(const char * name, unsigned threads,
+                        file_record * record) {
+  size_t head_size, tail_size;
+  char * head = model_section(name, 1, &head_size);
+  char * tail = model_section(name, 0, &tail_size);
+
+  unsigned num_ands = model->num_ands;
+  size_t bound = head_size + gates_bound() + tail_size;
+
+  int fd = open(name, O_RDWR | O_CREAT | O_TRUNC, 0666);
+  if (fd < 0) die(writing_error, "can not write output to '%s'", name);
+  preallocate(fd, name, bound);
+
+  void * map = mmap(0, bound, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (map == MAP_FAILED) die(writing_error, "can not map '%s'", name);
+  unsigned char * start = static_cast<unsigned char *>(map);
+
+  // split the gates into chunks, one per thread ('model' is thread local)
+  const aiger_and * ands = model->ands;
+  if (threads > num_ands / min_chunk) threads = num_ands / min_chunk;
+  if (!threads) threads = 1;
+
+  std::vector<unsigned> lower(threads + 1);
+  for (unsigned t = 0; t <= threads; t++)
+    lower[t] = static_cast<uint64_t>(num_ands) * t / threads;
+
+  // first pass computes the size of each chunk, second pass encodes it
+  std::vector<size_t> offset(threads + 1);
+  std::vector<std::thread> workers;
+  for (unsigned t = 1; t < threads; t++)
+    workers.push_back(std::thread([ands, &offset, &lower, t]() {
+      offset[t + 1] = gates_size(ands, lower[t], lower[t + 1]);
+    }));
+  offset[1] = gates_size(ands, lower[0], lower[1]);
+  for (size_t t = 0; t < workers.size(); t++) workers[t].join();
+  workers.clear();
+
+  offset[0] = head_size;
+  for (unsigned t = 1; t <= threads; t++) offset[t] += offset[t - 1];
+
+  for (unsigned t = 1; t < threads; t++)
+    workers.push_back(std::thread([start, ands, &offset, &lower, t]() {
+      encode_gates(start + offset[t], ands, lower[t], lower[t + 1]);
+    }));
+  memcpy(start, head, head_size);
+  encode_gates(start + offset[0], ands, lower[0], lower[1]);
+  for (size_t t = 0; t < workers.size(); t++) workers[t].join();
+
+  size_t size = offset[threads] + tail_size;
+  memcpy(start + offset[threads], tail, tail_size);
+  free(head);
+  free(tail);
+
+  if (record) {
+    record->name = name;
+    record->bytes = size;
+    record->checksum = update_checksum(initial_checksum,
+                                       reinterpret_cast<char *>(start), size);
+  }
+
+  if (munmap(map, bound)) die(writing_error, "can not unmap '%s'", name);
+  if (ftruncate(fd, size) || close(fd))
+    die(writing_error, "failed to write output to '%s'", name);
+
+  msg(2, "  Mapped %zu bytes, used %zu bytes in %u threads",
+    bound, size, threads);
+  return size;
+}
+/*------------------------------------------------------------------------*/
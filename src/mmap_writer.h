@@ -0,0 +1,35 @@
+/*------------------------------------------------------------------------*/
+/*! \file mmap_writer.h
+    \brief contains the memory-mapped writer for large binary AIGER files
+
+  The size of a binary AIGER file is bounded by the number of AND gates
+  times twice the maximal length of a delta. The bound is allocated with
+  'fallocate', the file is mapped into memory and the gates are encoded
+  directly into the mapping by the cores left over by the workers of the
+  batch. Finally the file is truncated to its real length.
+
+  Part of MultAIGenFuzzer: Generation-Based AIG Fuzzer for Multipliers
+  Copyright(C) 2022 Daniela Kaufmann, Johannes Kepler University Linz
+*/
+/*------------------------------------------------------------------------*/
+#ifndef AIGENFUZZER_SRC_MMAP_WRITER_H_
+#define AIGENFUZZER_SRC_MMAP_WRITER_H_
+/*------------------------------------------------------------------------*/
+#include "aig.h"
+/*------------------------------------------------------------------------*/
+
+/**
+    Writes the reencoded 'aiger* model' in binary AIGER format to the file
+    'name' through a preallocated memory mapping. Dies if the file can not
+    be created or mapped.
+
+    @param name name of output file
+    @param threads maximal number of threads encoding the gates
+    @param record receives size and checksum of the file, or 0
+
+    @return size of the file
+*/
+size_t write_mapped_aig(const char * name, unsigned threads,
+                        file_record * record);
+
+#endif  // AIGENFUZZER_SRC_MMAP_WRITER_H_
@@ -0,0 +1,114 @@
+/*------------------------------------------------------------------------*/
+/*! \file model_queue.cpp
+    \brief contains the bounded lock-free queue of the batch pipeline
+
+  Part of MultAIGenFuzzer: Generation-Based AIG Fuzzer for Multipliers
+  Copyright(C) 2022 Daniela Kaufmann, Johannes Kepler University Linz
+*/
+/*------------------------------------------------------------------------*/
+#include "model_queue.h"
+
+#include <assert.h>
+#include <stdint.h>
+/*------------------------------------------------------------------------*/
+
+void init_queue(model_queue * q, size_t capacity) {
+  size_t size = 2;
+  while (size < capacity) size *= 2;
+  q->cells = new queue_cell[size];
+  q->mask = size - 1;
+  for (size_t i = 0; i < size; i++) {
+    q->cells[i].sequence.store(i, std::memory_order_relaxed);
+    q->cells[i].data = 0;
+  }
+  q->tail.store(0, std::memory_order_relaxed);
+  q->head.store(0, std::memory_order_relaxed);
+  q->changes.store(0, std::memory_order_relaxed);
+  q->parked.store(0, std::memory_order_relaxed);
+}
+
+/*------------------------------------------------------------------------*/
+
+void reset_queue(model_queue * q) {
+  delete [] q->cells;
+  q->cells = 0;
+}
+
+/*------------------------------------------------------------------------*/
+
+bool push_queue(model_queue * q, void * item) {
+  assert(q->cells);
+  size_t pos = q->tail.load(std::memory_order_relaxed);
+  for (;;) {
+    queue_cell * cell = &q->cells[pos & q->mask];
+    intptr_t diff = static_cast<intptr_t>(
+      cell->sequence.load(std::memory_order_acquire) - pos);
+    // the cell is free for 'pos' if its sequence equals 'pos'
+    if (!diff) {
+      if (q->tail.compare_exchange_weak(pos, pos + 1,
+                                        std::memory_order_relaxed)) {
+        cell->data = item;
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        wake_queue(q);
+        return 1;
+      }
+    } else if (diff < 0) {
+      return 0;  // still filled from the previous round
+    } else {
+      pos = q->tail.load(std::memory_order_relaxed);
+    }
+  }
+}
+
+/*------------------------------------------------------------------------*/
+
+bool pop_queue(model_queue * q, void ** item) {
+  assert(q->cells);
+  size_t pos = q->head.load(std::memory_order_relaxed);
+  for (;;) {
+    queue_cell * cell = &q->cells[pos & q->mask];
+    intptr_t diff = static_cast<intptr_t>(
+      cell->sequence.load(std::memory_order_acquire) - (pos + 1));
+    // the cell is filled for 'pos' if its sequence equals 'pos + 1'
+    if (!diff) {
+      if (q->head.compare_exchange_weak(pos, pos + 1,
+                                        std::memory_order_relaxed)) {
+        *item = cell->data;
+        cell->sequence.store(pos + q->mask + 1, std::memory_order_release);
+        wake_queue(q);
+        return 1;
+      }
+    } else if (diff < 0) {
+      return 0;  // not yet filled
+    } else {
+      pos = q->head.load(std::memory_order_relaxed);
+    }
+  }
+}
+
+/*------------------------------------------------------------------------*/
+
+unsigned queue_changes(const model_queue * q) {
+  return q->changes.load();
+}
+
+/*------------------------------------------------------------------------*/
+
+void park_queue(model_queue * q, unsigned changes) {
+  std::unique_lock<std::mutex> lock(q->park_mutex);
+  q->parked++;
+  // a change counted before 'parked' is seen here, a later one notifies
+  while (q->changes.load() == changes) q->unparked.wait(lock);
+  q->parked--;
+}
+
+/*------------------------------------------------------------------------*/
+
+void wake_queue(model_queue * q) {
+  q->changes++;
+  if (!q->parked.load()) return;
+  // the lock orders the notification after the check of a parking thread
+  { std::lock_guard<std::mutex> lock(q->park_mutex); }
+  q->unparked.notify_all();
+}
+/*------------------------------------------------------------------------*/
@@ -0,0 +1,118 @@
+/*------------------------------------------------------------------------*/
+/*! \file model_queue.h
+    \brief contains the bounded lock-free queue of the batch pipeline
+
+  A bounded multi-producer multi-consumer queue following Vyukov: each
+  cell carries a sequence number, which tells producers and consumers
+  whether the cell is free or filled for their position. Positions are
+  claimed by compare-and-swap on 'head' and 'tail', hence the queue never
+  blocks and never allocates after initialization.
+
+  A thread finding the queue empty or full parks until the queue changes,
+  which is counted by an event count: it reads the count before its last
+  attempt and sleeps only while the count is unchanged. Pushes and pops
+  take the lock only if a thread is parked.
+
+  Part of MultAIGenFuzzer: Generation-Based AIG Fuzzer for Multipliers
+  Copyright(C) 2022 Daniela Kaufmann, Johannes Kepler University Linz
+*/
+/*------------------------------------------------------------------------*/
+#ifndef AIGENFUZZER_SRC_MODEL_QUEUE_H_
+#define AIGENFUZZER_SRC_MODEL_QUEUE_H_
+/*------------------------------------------------------------------------*/
+#include <stddef.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+/*------------------------------------------------------------------------*/
+
+/**
+    Cell of a model_queue
+*/
+struct queue_cell {
+  std::atomic<size_t> sequence;  // /< position the cell is ready for
+  void * data;                   // /< queued item
+};
+
+/**
+    Bounded lock-free queue of pointers
+*/
+struct model_queue {
+  queue_cell * cells;             // /< ring of 'mask + 1' cells
+  size_t mask;                    // /< capacity - 1
+  char tail_line[64];             // /< keeps 'tail' and 'head' in separate
+  std::atomic<size_t> tail;       //    cache lines, next position to push
+  char head_line[64];
+  std::atomic<size_t> head;       // /< next position to pop
+  char park_line[64];
+  std::atomic<unsigned> changes;  // /< number of pushes, pops and wakes
+  std::atomic<unsigned> parked;   // /< number of parked threads
+  std::mutex park_mutex;          // /< protects waiting on 'unparked'
+  std::condition_variable unparked;  // /< signaled after each change
+};
+
+/**
+    Allocates the cells of 'q', the capacity is rounded up to a power of two
+
+    @param q model_queue
+    @param capacity minimal number of items
+*/
+void init_queue(model_queue * q, size_t capacity);
+
+/**
+    Deallocates the cells of 'q'
+
+    @param q model_queue
+*/
+void reset_queue(model_queue * q);
+
+/**
+    Appends 'item' to 'q'
+
+    @param q model_queue
+    @param item pointer
+
+    @return false if 'q' is full
+*/
+bool push_queue(model_queue * q, void * item);
+
+/**
+    Removes the oldest item of 'q'
+
+    @param q model_queue
+    @param item set to the removed pointer
+
+    @return false if 'q' is empty
+*/
+bool pop_queue(model_queue * q, void ** item);
+
+/**
+    Returns the event count of 'q', read before the last attempt to push
+    or pop ahead of 'park_queue'
+
+    @param q model_queue
+
+    @return number of changes of 'q'
+*/
+unsigned queue_changes(const model_queue * q);
+
+/**
+    Parks the calling thread until 'q' has changed after 'changes' were
+    counted
+
+    @param q model_queue
+    @param changes result of 'queue_changes'
+*/
+void park_queue(model_queue * q, unsigned changes);
+
+/**
+    Counts a change of 'q' and wakes its parked threads, called by
+    'push_queue' and 'pop_queue' and when the parked threads have to
+    check another condition
+
+    @param q model_queue
+*/
+void wake_queue(model_queue * q);
+
+#endif  // AIGENFUZZER_SRC_MODEL_QUEUE_H_
@@ -12,28 +12,127 @@
 static const char * USAGE =
 "[maf] \n"
 "[maf] ### USAGE ###\n"
-"[maf] usage : multaigenfuzzer  <-i n> <out>  [-cl] [-h] [-r] [-s n] \n"
+"[maf] usage : multaigenfuzzer  <-i n> <out> [<out> ...]  [-cl] [-h] [-r] [-s n] \n"
+"[maf]                          [-n count] [-j threads] [--cnf-xor] \n"
 "[maf] \n"
 "[maf] -i n    sets the input bit-width to 'n' \n"
-"[maf] out     name of output file\n"
+"[maf]         or to a list of widths and ranges, e.g. '4..1024:4,2048',\n"
+"[maf]         the output file names need to contain '%w'\n"
+"[maf] out     name of output file, the suffix selects the format:\n"
+"[maf]         '.aag' ASCII AIGER, '.cnf' DIMACS CNF, otherwise binary AIGER\n"
+"[maf]         several output files are written in one pass\n"
+"[maf]         binary AIGER is always reencoded, the others only with '-r'\n"
+"[maf]         '%w' is replaced by the width, '%s' by the seed\n"
 "[maf] \n"
 "[maf] -cl     removes carry-lookahead adder from the fuzzing modules \n"
 "[maf] -h      prints this help\n"
 "[maf] -r      enables reencoding of generated AIG\n"
 "[maf] -s n    sets the seed to 'n'\n"
+"[maf] -n count  generates 'count' multipliers with successive seeds,\n"
+"[maf]           the output file names need to contain '%s'\n"
+"[maf] -j threads  generates the multipliers of '-n' in parallel\n"
+"[maf] --miter  generates the miter of each fuzzed multiplier and a plain\n"
+"[maf]          array multiplier over the same inputs, its only output\n"
+"[maf]          is 1 iff the products differ\n"
+"[maf] --miter-seed s  generates the miter of each fuzzed multiplier and a\n"
+"[maf]          second one fuzzed with seed 's', successive seeds for '-n'\n"
+"[maf] --check N  simulates each multiplier on 'N' random input patterns\n"
+"[maf]           and compares the outputs with the product\n"
+"[maf] --check-exhaustive  simulates each multiplier of width up to 12 on\n"
+"[maf]           all input patterns, wider ones as given by '--check'\n"
+"[maf] --check-corners  simulates each multiplier on about 12 n directed\n"
+"[maf]           vectors such as all-ones and powers of two, checked by GMP\n"
+"[maf] --check-live  simulates each gate on 64 random input patterns while\n"
+"[maf]           it is generated and compares each output when it is added\n"
+"[maf] --vectors N  simulates each multiplier on 'N' random input patterns\n"
+"[maf]           and writes them with their products to the output files\n"
+"[maf]           ending in '.vec', without products to those ending in\n"
+"[maf]           '.stim' as stimulus of aigsim\n"
+"[maf] --simd k   simulates with kernel 'k', 'portable', 'avx2' or 'avx512',\n"
+"[maf]            instead of the widest kernel supported by the CPU\n"
+"[maf] --levelized  simulates the gates grouped by column and sorted by\n"
+"[maf]           level, on the cores left over by '-j'\n"
+"[maf] --check-shared  simulates the patterns of '--check' in one value\n"
+"[maf]           array shared by the threads, partitioned by level,\n"
+"[maf]           instead of one array per thread\n"
+"[maf] --estimate  prints the expected gates, literal range, file size,\n"
+"[maf]             memory and time of the instances without generating\n"
+"[maf] --calibrate measures the generation time of this machine for\n"
+"[maf]             '--estimate'\n"
+"[maf] --time-budget t  generates multipliers until 't' seconds passed,\n"
+"[maf]                  cycling through the widths of '-i', instead of\n"
+"[maf]                  '-n', the output file names need to contain '%s'\n"
+"[maf] --sample-widths  draws the widths of '--time-budget' uniformly\n"
+"[maf]                  from the list of '-i'\n"
+"[maf] --writers k  writes the multipliers in 'k' separate threads, the\n"
+"[maf]              threads of '-j' only generate\n"
+"[maf] --mem-limit m  starts a parallel job only if the predicted memory\n"
+"[maf]                of all running jobs stays below 'm' megabytes,\n"
+"[maf]                or kilo-, mega-, gigabytes with suffix 'K', 'M', 'G'\n"
+"[maf] --shard i/k  generates only the multipliers 'j' of '-n' with\n"
+"[maf]              j % k == i, needs '-s'\n"
+"[maf] --manifest f  writes the manifest 'f' listing size and checksum\n"
+"[maf]               of each written file\n"
+"[maf] --resume      continues an interrupted batch, skips the instances\n"
+"[maf]               listed in the manifest of '--manifest'\n"
+"[maf] --dedup       skips multipliers with the same structure as an\n"
+"[maf]               earlier multiplier of the batch\n"
+"[maf] --known f     skips multipliers with the structure of a multiplier\n"
+"[maf]               listed in the manifest 'f' of another shard, implies\n"
+"[maf]               '--dedup', can be given several times\n"
+"[maf] --merge f     merges the manifests given as 'out' into 'f'\n"
+"[maf] \n"
+"[maf] --cnf-xor   encodes XOR gates by four clauses in CNF output\n"
+"[maf] \n"
+"[maf] --async          writes output files asynchronously using io_uring\n"
+"[maf] --mmap           writes binary AIGER files through a preallocated\n"
+"[maf]                  memory mapping, encoded in parallel\n"
+"[maf] --archive f      appends the generated AIG to the archive 'f'\n"
+"[maf] --list f         prints the index of the archive 'f'\n"
+"[maf] --extract f      copies the AIG with the width, seed and options\n"
+"[maf]                  given by '-i', '-s', '-cl', '-r', '--miter' and\n"
+"[maf]                  '--miter-seed'\n"
+"[maf]                  from the archive 'f' to 'out'\n"
 "[maf] \n";
 /*------------------------------------------------------------------------*/
-#include "fuzzer.h"
+#include "batch.h"
+#include "simulate.h"
+#include "vectors.h"
 #include <algorithm>
 #include <climits>
 #include <cstring>
 #include <time.h>
 
 /*------------------------------------------------------------------------*/
-// / Name of the input file
-static const char * output_name = 0;
+// / Names of the output files
+static std::vector<const char *> output_names;
 static double seed = 0;
 
+// / Name of the archive file
+static const char * archive_name = 0;
+
+// / Number of generated multipliers
+static unsigned count = 1;
+
+// / Number of worker threads
+static unsigned threads = 1;
+
+// / Number of writer threads of the pipeline, 0 without pipeline
+static unsigned writers = 0;
+
+// / Seconds of a campaign, 0 without time budget
+static double time_budget = 0;
+
+// / Memory limit of parallel jobs in bytes, 0 if unlimited
+static size_t memory_limit = 0;
+
+// / Shard 'shard' of 'shards' generated by this run
+static unsigned shard = 0, shards = 1;
+
+// / Names of manifest files
+static const char * manifest_name = 0;
+static const char * merge_name = 0;
+
 
 static int invalid_argument = 11;
 
@@ -44,10 +143,32 @@ static bool isNumber(const std::string &s) {
 }
 
 
+/**
+    Parses a memory size in megabytes or with suffix 'K', 'M' or 'G'
+
+    @return false if 's' is invalid
+*/
+static bool parse_memory(const char * s, size_t * res) {
+  unsigned long long n;
+  char unit = 'M';
+  int pos = 0;
+  if (sscanf(s, "%llu%n", &n, &pos) != 1 || s[0] == '-') return 0;
+  if (s[pos]) unit = s[pos++];
+  if (s[pos] || !n) return 0;
+  switch (unit) {
+    case 'K': case 'k': *res = n << 10; break;
+    case 'M': case 'm': *res = n << 20; break;
+    case 'G': case 'g': *res = n << 30; break;
+    default: return 0;
+  }
+  return 1;
+}
+
 /**
     @see init_all_signal_handlers()
 */
-static void init_all(double size, bool use_cl) {
+static void init_all(const char * sizes, bool use_cl, bool miter,
+                     const char * miter_seed) {
   init_all_signal_handers();
 
   msg(1,"MultAIGenFuzzer " VERSION);
@@ -65,16 +186,20 @@ static void init_all(double size, bool use_cl) {
   msg(1, "Initialization");
   msg(1, "==========================================================");
   msg(1, "  Seed:            %.f", seed);
-  msg(1, "  Size:            %g", size);
+  msg(1, "  Size:            %s", sizes);
   msg(1, "  CLA elements:    %s", use_cl ? "ON" : "OFF");
+  if (miter) msg(1, "  Miter:           reference array multiplier");
+  if (miter_seed)
+    msg(1, "  Miter:           fuzzed multiplier with seed %s", miter_seed);
+  if (count > 1) msg(1, "  Instances:       %u", count);
+  if (threads > 1) msg(1, "  Threads:         %u", threads);
+  if (writers) msg(1, "  Writers:         %u", writers);
+  if (time_budget) msg(1, "  Time budget:     %g seconds", time_budget);
+  if (memory_limit)
+    msg(1, "  Memory limit:    %.f MB", memory_limit / 1048576.0);
   msg(1,"");
 
-  srand(seed);
-
   init_time = process_time();
-
-  init_aig(size);
-
 }
 /*------------------------------------------------------------------------*/
 
@@ -84,7 +209,6 @@ static void init_all(double size, bool use_cl) {
 */
 static void reset_all() {
   reset_all_signal_handlers();
-  reset_aig();
 
   reset_time = process_time();
 }
@@ -97,9 +221,34 @@ static void reset_all() {
     Prints statistics to stdout after finishing.
 */
 int main(int argc, char ** argv) {
-  int size = 0;
+  std::vector<unsigned> widths;
+  const char * sizes = "0";
   bool reencode = 0;
   bool use_cl = 1;
+  bool compact_xor = 0;
+  bool seed_given = 0;
+  bool async = 0;
+  bool mapped = 0;
+  bool sample_widths = 0;
+  bool resume = 0;
+  bool dedup = 0;
+  uint64_t check = 0;
+  uint64_t vectors = 0;
+  const char * simd = 0;
+  bool exhaustive = 0;
+  bool corners = 0;
+  bool levelized = 0;
+  bool shared = 0;
+  bool live = 0;
+  bool miter = 0;
+  bool fuzzed_miter = 0;
+  unsigned miter_seed = 0;
+  const char * miter_seed_arg = 0;
+  std::vector<const char *> known;
+  bool estimate = 0;
+  bool calibrate = 0;
+  const char * list_name = 0;
+  const char * extract_name = 0;
 
   for (int i = 1; i < argc; i++) {
     if (!strcmp(argv[i], "-h") ||
@@ -113,12 +262,30 @@ int main(int argc, char ** argv) {
     } else if (!strcmp(argv[i], "-v3")) { verbose = 3;
     } else if (!strcmp(argv[i], "-r"))  { reencode = 1;
     } else if (!strcmp(argv[i], "-cl"))  { use_cl = 0;
+    } else if (!strcmp(argv[i], "--cnf-xor"))  { compact_xor = 1;
+    } else if (!strcmp(argv[i], "--async"))  { async = 1;
+    } else if (!strcmp(argv[i], "--mmap"))  { mapped = 1;
+    } else if (!strcmp(argv[i], "--sample-widths"))  { sample_widths = 1;
+    } else if (!strcmp(argv[i], "--resume"))  { resume = 1;
+    } else if (!strcmp(argv[i], "--dedup"))  { dedup = 1;
+    } else if (!strcmp(argv[i], "--check-exhaustive"))  { exhaustive = 1;
+    } else if (!strcmp(argv[i], "--check-corners"))  { corners = 1;
+    } else if (!strcmp(argv[i], "--levelized"))  { levelized = 1;
+    } else if (!strcmp(argv[i], "--check-shared"))  { shared = 1;
+    } else if (!strcmp(argv[i], "--check-live"))  { live = 1;
+    } else if (!strcmp(argv[i], "--miter"))  { miter = 1;
+    } else if (!strcmp(argv[i], "--estimate"))  { estimate = 1;
+    } else if (!strcmp(argv[i], "--calibrate"))  { calibrate = 1;
     } else if (!strcmp(argv[i], "-i")) {
       if(i == argc-1) die(invalid_argument, "no value for option '-i' given");
 
-      if(!isNumber(argv[++i])) die(invalid_argument, "argument '%s' invalid, \n         "
-        "option '-i' needs to be followed by a positive number", argv[i]);
-      else size = std::stoi(argv[i], nullptr);
+      sizes = argv[++i];
+      widths.clear();
+      if (isNumber(sizes)) widths.push_back(std::stoi(sizes, nullptr));
+      else if (!parse_widths(sizes, &widths))
+        die(invalid_argument, "argument '%s' invalid, \n         "
+        "option '-i' needs to be followed by a positive number or a list\n"
+        "         of numbers and ranges 'a..b' or 'a..b:step'", sizes);
 
     } else if (!strcmp(argv[i], "-s")) {
       if(i == argc-1) die(invalid_argument, "no value for option '-s' given");
@@ -126,30 +293,255 @@ int main(int argc, char ** argv) {
       if(!isNumber(argv[++i])) die(invalid_argument, "argument '%s' invalid, \n                  "
         "option '-s' needs to be followed by a nonnegative integer", argv[i]);
       else seed = std::stoi(argv[i], nullptr);
+      seed_given = 1;
+
+    } else if (!strcmp(argv[i], "-n")) {
+      if(i == argc-1) die(invalid_argument, "no value for option '-n' given");
+
+      if(!isNumber(argv[++i]) || !std::stoi(argv[i], nullptr))
+        die(invalid_argument, "argument '%s' invalid, \n         "
+        "option '-n' needs to be followed by a positive number", argv[i]);
+      else count = std::stoi(argv[i], nullptr);
+
+    } else if (!strcmp(argv[i], "-j")) {
+      if(i == argc-1) die(invalid_argument, "no value for option '-j' given");
+
+      if(!isNumber(argv[++i]) || !std::stoi(argv[i], nullptr))
+        die(invalid_argument, "argument '%s' invalid, \n         "
+        "option '-j' needs to be followed by a positive number", argv[i]);
+      else threads = std::stoi(argv[i], nullptr);
+
+    } else if (!strcmp(argv[i], "--check")) {
+      if(i == argc-1) die(invalid_argument, "no value for option '--check' given");
+
+      if(!isNumber(argv[++i]) || !(check = strtoull(argv[i], 0, 10)))
+        die(invalid_argument, "argument '%s' invalid, \n         "
+        "option '--check' needs to be followed by a positive number", argv[i]);
+
+    } else if (!strcmp(argv[i], "--vectors")) {
+      if(i == argc-1) die(invalid_argument, "no value for option '--vectors' given");
+
+      if(!isNumber(argv[++i]) || !(vectors = strtoull(argv[i], 0, 10)))
+        die(invalid_argument, "argument '%s' invalid, \n         "
+        "option '--vectors' needs to be followed by a positive number", argv[i]);
+
+    } else if (!strcmp(argv[i], "--miter-seed")) {
+      if(i == argc-1) die(invalid_argument, "no value for option '--miter-seed' given");
+
+      if(!isNumber(argv[++i])) die(invalid_argument, "argument '%s' invalid, \n         "
+        "option '--miter-seed' needs to be followed by a nonnegative integer", argv[i]);
+      miter_seed_arg = argv[i];
+      miter_seed = std::stoi(argv[i], nullptr);
+      fuzzed_miter = 1;
+
+    } else if (!strcmp(argv[i], "--simd")) {
+      if(i == argc-1) die(invalid_argument, "no value for option '--simd' given");
+      simd = argv[++i];
+
+    } else if (!strcmp(argv[i], "--time-budget")) {
+      if(i == argc-1) die(invalid_argument, "no value for option '--time-budget' given");
+
+      char * end;
+      time_budget = strtod(argv[++i], &end);
+      if (*end || !(time_budget > 0))
+        die(invalid_argument, "argument '%s' invalid, \n         "
+        "option '--time-budget' needs to be followed by a positive number of\n"
+        "         seconds", argv[i]);
+
+    } else if (!strcmp(argv[i], "--writers")) {
+      if(i == argc-1) die(invalid_argument, "no value for option '--writers' given");
+
+      if(!isNumber(argv[++i]) || !std::stoi(argv[i], nullptr))
+        die(invalid_argument, "argument '%s' invalid, \n         "
+        "option '--writers' needs to be followed by a positive number", argv[i]);
+      else writers = std::stoi(argv[i], nullptr);
+
+    } else if (!strcmp(argv[i], "--mem-limit")) {
+      if(i == argc-1) die(invalid_argument, "no value for option '--mem-limit' given");
+
+      if (!parse_memory(argv[++i], &memory_limit))
+        die(invalid_argument, "argument '%s' invalid, \n         "
+        "option '--mem-limit' needs to be followed by a positive number of\n"
+        "         megabytes or a number with suffix 'K', 'M' or 'G'", argv[i]);
+
+    } else if (!strcmp(argv[i], "--shard")) {
+      if(i == argc-1) die(invalid_argument, "no value for option '--shard' given");
+
+      int pos = 0;
+      if (sscanf(argv[++i], "%u/%u%n", &shard, &shards, &pos) != 2 ||
+          argv[i][pos] || !shards || shard >= shards)
+        die(invalid_argument, "argument '%s' invalid, \n         "
+        "option '--shard' needs to be followed by 'i/k' with i < k", argv[i]);
+
+    } else if (!strcmp(argv[i], "--manifest")) {
+      if(i == argc-1) die(invalid_argument, "no file for option '--manifest' given");
+      manifest_name = argv[++i];
+
+    } else if (!strcmp(argv[i], "--known")) {
+      if(i == argc-1) die(invalid_argument, "no file for option '--known' given");
+      known.push_back(argv[++i]);
+      dedup = 1;
+
+    } else if (!strcmp(argv[i], "--merge")) {
+      if(i == argc-1) die(invalid_argument, "no file for option '--merge' given");
+      merge_name = argv[++i];
+
+    } else if (!strcmp(argv[i], "--archive")) {
+      if(i == argc-1) die(invalid_argument, "no file for option '--archive' given");
+      archive_name = argv[++i];
+
+    } else if (!strcmp(argv[i], "--list")) {
+      if(i == argc-1) die(invalid_argument, "no file for option '--list' given");
+      list_name = argv[++i];
+
+    } else if (!strcmp(argv[i], "--extract")) {
+      if(i == argc-1) die(invalid_argument, "no file for option '--extract' given");
+      extract_name = argv[++i];
 
-    } else if (output_name) {
-      die(invalid_argument, "too many arguments '%s' and '%s'(try '-h')",
-        output_name, argv[i]);
     } else {
-      output_name = argv[i];
+      output_names.push_back(argv[i]);
     }
   }
 
 
-  if (!output_name)  die(invalid_argument, "no output file given(try '-h')");
+  if (list_name) {
+    list_archive(list_name);
+    return 0;
+  }
 
+  if (calibrate) {
+    calibrate_throughput();
+    return 0;
+  }
 
+  if (merge_name) {
+    if (output_names.empty())
+      die(invalid_argument, "option '--merge' needs manifests to merge");
+    merge_manifests(merge_name, output_names);
+    return 0;
+  }
 
-  init_all(size, use_cl);
-  generate_fuzzed_mult(size, use_cl);
+  if (shards > 1 && !seed_given)
+    die(invalid_argument, "option '--shard' needs '-s'");
+
+  if (widths.empty()) widths.push_back(0);
+
+  archive_key key;
+  key.width = widths[0];
+  key.options = (use_cl ? 0 : archive_no_cla) | (reencode ? archive_reencoded : 0) |
+                (miter ? archive_miter : 0) |
+                (fuzzed_miter ? archive_fuzzed_miter : 0);
+
+  if (extract_name) {
+    if (!seed_given) die(invalid_argument, "option '--extract' needs '-s'");
+    if (widths.size() != 1)
+      die(invalid_argument, "option '--extract' needs one width");
+    if (output_names.size() != 1)
+      die(invalid_argument, "option '--extract' needs one output file");
+    key.seed = seed;
+    if (fuzzed_miter) key.seed |= static_cast<uint64_t>(miter_seed) << 32;
+    extract_from_archive(extract_name, key, output_names[0]);
+    return 0;
+  }
 
-  write_fuzzed_model(output_name, reencode);
+  if (output_names.empty() && !archive_name && !estimate && !check &&
+      !exhaustive && !corners && !live)
+    die(invalid_argument, "no output file given(try '-h')");
+
+  if (miter && fuzzed_miter)
+    die(invalid_argument, "options '--miter' and '--miter-seed' exclude "
+      "each other");
+
+  if (resume && !manifest_name)
+    die(invalid_argument, "option '--resume' needs '--manifest'");
+
+  if (sample_widths && !time_budget)
+    die(invalid_argument, "option '--sample-widths' needs '--time-budget'");
+
+  if (exhaustive && !check && !widths.empty() &&
+      *std::max_element(widths.begin(), widths.end()) > max_exhaustive_width)
+    msg(1, "Warning: widths above %u are not checked by "
+      "'--check-exhaustive' without '--check'", max_exhaustive_width);
+
+  for (size_t i = 0; i < output_names.size(); i++) {
+    if (time_budget && !strstr(output_names[i], "%s"))
+      die(invalid_argument, "output file '%s' needs '%%s' for option "
+        "'--time-budget'", output_names[i]);
+    if (count > 1 && !strstr(output_names[i], "%s"))
+      die(invalid_argument, "output file '%s' needs '%%s' for option '-n'",
+        output_names[i]);
+    if (widths.size() > 1 && !strstr(output_names[i], "%w"))
+      die(invalid_argument, "output file '%s' needs '%%w' for several widths",
+        output_names[i]);
+  }
+
+  // vector files are written by the simulation, not as model
+  std::vector<const char *> vector_names, model_names;
+  for (size_t i = 0; i < output_names.size(); i++) {
+    if (is_vector_file(output_names[i])) vector_names.push_back(output_names[i]);
+    else model_names.push_back(output_names[i]);
+  }
+  if (vectors && vector_names.empty())
+    die(invalid_argument, "option '--vectors' needs a vector file ending in "
+      "'.vec' or '.stim'");
+  if (!vectors && !vector_names.empty())
+    die(invalid_argument, "vector file '%s' needs option '--vectors'",
+      vector_names[0]);
+
+  init_all(sizes, use_cl, miter, fuzzed_miter ? miter_seed_arg : 0);
+  if (check || exhaustive || corners || vectors)
+    select_simulation_kernel(simd);
+
+  batch_settings settings;
+  settings.patterns = model_names;
+  settings.vectors = vectors;
+  settings.vector_patterns = vector_names;
+  settings.archive_name = archive_name;
+  settings.widths = widths;
+  settings.seed = seed;
+  settings.count = count;
+  settings.threads = threads;
+  settings.writers = writers;
+  settings.shard = shard;
+  settings.shards = shards;
+  settings.manifest_name = manifest_name;
+  settings.use_cl = use_cl;
+  settings.miter = miter;
+  settings.fuzzed_miter = fuzzed_miter;
+  settings.miter_seed = miter_seed;
+  settings.reencode = reencode;
+  settings.compact_xor = compact_xor;
+  settings.async = async;
+  settings.mapped = mapped;
+  settings.memory_limit = memory_limit;
+  settings.time_budget = time_budget;
+  settings.sample_widths = sample_widths;
+  settings.resume = resume;
+  settings.check = check;
+  settings.check_exhaustive = exhaustive;
+  settings.check_corners = corners;
+  settings.levelized = levelized;
+  settings.check_shared = shared;
+  settings.check_live = live;
+  settings.dedup = dedup;
+  settings.known = known;
+
+  if (estimate) {
+    estimate_batch(settings);
+    return 0;
+  }
 
+  // SIGINT and SIGTERM end the batch after the instances in flight, a
+  // single instance is stopped at once
+  if (count > 1 || widths.size() > 1 || time_budget || manifest_name)
+    enable_graceful_stop();
+  run_batch(settings);
 
   reset_all();
 
 
   print_statistics();
+  raise_stop_signal();
 
   return 0;
 }
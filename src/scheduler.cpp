@@ -0,0 +1,322 @@
+/*------------------------------------------------------------------------*/
+/*! \file scheduler.cpp
+    \brief contains the work-stealing scheduler of parallel batches
+
+  Part of MultAIGenFuzzer: Generation-Based AIG Fuzzer for Multipliers
+  Copyright(C) 2022 Daniela Kaufmann, Johannes Kepler University Linz
+*/
+/*------------------------------------------------------------------------*/
+#include "scheduler.h"
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+#include "signal_statistics.h"
+/*------------------------------------------------------------------------*/
+// Local Variables
+
+/**
+    Deque of one worker, the front holds its largest job
+*/
+struct job_deque {
+  std::mutex lock;             // /< taken by owner and thieves
+  std::deque<batch_job> jobs;  // /< sorted largest first
+  double remaining;            // /< predicted cost of 'jobs'
+
+  job_deque() : remaining(0) {}
+};
+
+static std::vector<job_deque> * deques;
+
+static std::mutex campaign_mutex;         // /< protects the following
+static bool campaign;                     // /< jobs are created on demand
+static std::vector<unsigned> campaign_widths;
+static double campaign_deadline;          // /< in wall-clock seconds
+static bool campaign_sample;              // /< widths are drawn
+static unsigned campaign_seed;
+static unsigned campaign_shard, campaign_shards;
+static unsigned campaign_taken;           // /< number of taken numbers
+static unsigned campaign_created;         // /< number of created jobs
+static std::set<unsigned> campaign_skipped;  // /< finished earlier
+
+static std::mutex admission_mutex;        // /< protects the following
+static std::condition_variable admitted;  // /< signaled after each job
+static double memory_limit;               // /< in bytes, 0 if unlimited
+static std::vector<double> reserved;      // /< predicted memory per worker
+static double predicted_peak;             // /< maximum of 'total_reserved'
+static double base_memory;                // /< resident before the batch
+static double correction;                 // /< measured / predicted memory
+static unsigned waiting;                  // /< workers waiting for admission
+/*------------------------------------------------------------------------*/
+
+double predicted_cost(unsigned width) {
+  double n = width;
+  return n * n * (1 + n / 2048);
+}
+
+/*------------------------------------------------------------------------*/
+
+static bool larger_job(const batch_job & a, const batch_job & b) {
+  if (a.cost != b.cost) return a.cost > b.cost;
+  return a.number < b.number;
+}
+
+/*------------------------------------------------------------------------*/
+
+void init_scheduler(std::vector<batch_job> & jobs, unsigned workers) {
+  for (size_t i = 0; i < jobs.size(); i++)
+    jobs[i].cost = predicted_cost(jobs[i].width);
+  std::sort(jobs.begin(), jobs.end(), larger_job);
+
+  deques = new std::vector<job_deque>(workers);
+  for (size_t i = 0; i < jobs.size(); i++) {
+    jobs[i].sequence = i;
+    job_deque & d = (*deques)[i % workers];
+    d.jobs.push_back(jobs[i]);
+    d.remaining += jobs[i].cost;
+  }
+}
+
+/*------------------------------------------------------------------------*/
+
+void init_campaign(const std::vector<unsigned> & widths, double seconds,
+                   bool sample, unsigned seed, unsigned shard,
+                   unsigned shards) {
+  campaign = 1;
+  campaign_widths = widths;
+  campaign_deadline = wall_clock_time() + seconds;
+  campaign_sample = sample;
+  campaign_seed = seed;
+  campaign_shard = shard;
+  campaign_shards = shards;
+  campaign_taken = campaign_created = 0;
+  campaign_skipped.clear();
+}
+
+/*------------------------------------------------------------------------*/
+
+void skip_campaign_jobs(const std::set<unsigned> & numbers) {
+  campaign_skipped = numbers;
+}
+
+/*------------------------------------------------------------------------*/
+
+unsigned campaign_jobs() {
+  return campaign_created;
+}
+
+/*------------------------------------------------------------------------*/
+
+/**
+    Mixes the bits of 'x' (splitmix64 finalizer)
+*/
+static uint64_t mix_bits(uint64_t x) {
+  x += 0x9e3779b97f4a7c15ull;
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+  return x ^ (x >> 31);
+}
+
+/*------------------------------------------------------------------------*/
+
+void campaign_job(unsigned number, batch_job * job) {
+  unsigned widths = campaign_widths.size();
+  if (campaign_sample) {
+    uint64_t hash = mix_bits(static_cast<uint64_t>(campaign_seed) << 32 |
+                             number);
+    job->width = campaign_widths[hash % widths];
+    job->index = number;
+  } else {
+    job->width = campaign_widths[number % widths];
+    job->index = number / widths;
+  }
+  job->number = number;
+}
+
+/*------------------------------------------------------------------------*/
+
+/**
+    Creates the next job of the campaign
+
+    @return false after the deadline
+*/
+static bool next_campaign_job(batch_job * job) {
+  std::lock_guard<std::mutex> lock(campaign_mutex);
+  if (wall_clock_time() >= campaign_deadline) return 0;
+
+  unsigned number;
+  do number = campaign_shard + campaign_taken++ * campaign_shards;
+  while (campaign_skipped.count(number));
+
+  campaign_job(number, job);
+  job->sequence = campaign_created++;
+  job->cost = predicted_cost(job->width);
+  return 1;
+}
+
+/*------------------------------------------------------------------------*/
+
+bool next_batch_job(unsigned worker, batch_job * job) {
+  if (stop_signal) return 0;
+  if (campaign) return next_campaign_job(job);
+
+  job_deque & own = (*deques)[worker];
+  {
+    std::lock_guard<std::mutex> lock(own.lock);
+    if (!own.jobs.empty()) {
+      *job = own.jobs.front();
+      own.jobs.pop_front();
+      own.remaining -= job->cost;
+      return 1;
+    }
+  }
+
+  // steal from the back of the deque with the largest remaining cost
+  for (;;) {
+    job_deque * victim = 0;
+    double largest = 0;
+    for (size_t i = 0; i < deques->size(); i++) {
+      job_deque & d = (*deques)[i];
+      std::lock_guard<std::mutex> lock(d.lock);
+      if (!d.jobs.empty() && (!victim || d.remaining > largest)) {
+        victim = &d;
+        largest = d.remaining;
+      }
+    }
+    if (!victim) return 0;
+
+    std::lock_guard<std::mutex> lock(victim->lock);
+    if (victim->jobs.empty()) continue;  // taken meanwhile
+    *job = victim->jobs.back();
+    victim->jobs.pop_back();
+    victim->remaining -= job->cost;
+    return 1;
+  }
+}
+
+/*------------------------------------------------------------------------*/
+
+void reset_scheduler() {
+  delete deques;
+  deques = 0;
+  campaign = 0;
+}
+
+/*------------------------------------------------------------------------*/
+
+void init_admission(size_t limit, unsigned workers) {
+  memory_limit = limit;
+  reserved.assign(workers, 0);
+  predicted_peak = 0;
+  waiting = 0;
+  base_memory = maximum_resident_set_size();
+  correction = 1;
+}
+
+/*------------------------------------------------------------------------*/
+
+/**
+    Sum of the reservations, summed up again so that it is exactly 0 if no
+    job is running
+*/
+static double total_reserved() {
+  double res = 0;
+  for (size_t i = 0; i < reserved.size(); i++) res += reserved[i];
+  return res;
+}
+
+/*------------------------------------------------------------------------*/
+
+/**
+    Checks whether 'bytes' more predicted memory fit into the limit
+*/
+static bool fits_memory(double bytes) {
+  return base_memory + correction * (total_reserved() + bytes) <=
+         memory_limit;
+}
+
+/*------------------------------------------------------------------------*/
+
+void admit_job(unsigned worker, double bytes, void (*release)()) {
+  if (!memory_limit) return;
+
+  std::unique_lock<std::mutex> lock(admission_mutex);
+  double & own = reserved[worker];
+  // the memory kept from previous jobs is reused
+  if (bytes > own && !fits_memory(bytes - own)) {
+    lock.unlock();
+    release();
+    lock.lock();
+    own = 0;
+    msg(2, "  Worker %u waits for %.1f MB", worker,
+      correction * bytes / (1 << 20));
+    waiting++;
+    admitted.wait(lock, [bytes] {
+      return !total_reserved() || fits_memory(bytes);
+    });
+    waiting--;
+    if (!fits_memory(bytes))
+      msg(1, "  Predicted memory %.1f MB exceeds the limit of %.1f MB",
+        correction * bytes / (1 << 20), memory_limit / (1 << 20));
+  }
+  if (bytes > own) own = bytes;
+  if (total_reserved() > predicted_peak) predicted_peak = total_reserved();
+}
+
+/*------------------------------------------------------------------------*/
+
+void finish_admitted_job(unsigned worker, void (*release)()) {
+  if (!memory_limit) return;
+
+  double measured = maximum_resident_set_size() - base_memory;
+  bool blocked;
+  {
+    std::lock_guard<std::mutex> lock(admission_mutex);
+    if (predicted_peak > 0 && measured > 0) {
+      // jobs still running may not have reached their peak yet, so the
+      // correction is lowered only once all other jobs have finished
+      double ratio = measured / predicted_peak;
+      if (ratio > correction || total_reserved() == reserved[worker])
+        correction = ratio;
+      if (correction < 0.5) correction = 0.5;
+      if (correction > 4) correction = 4;
+    }
+    blocked = release && waiting;
+  }
+  // the memory kept for the next job is given to the waiting workers
+  if (blocked) {
+    release();
+    std::lock_guard<std::mutex> lock(admission_mutex);
+    reserved[worker] = 0;
+  }
+  admitted.notify_all();
+}
+
+/*------------------------------------------------------------------------*/
+
+void leave_admission(unsigned worker) {
+  if (!memory_limit) return;
+
+  {
+    std::lock_guard<std::mutex> lock(admission_mutex);
+    reserved[worker] = 0;
+  }
+  admitted.notify_all();
+}
+
+/*------------------------------------------------------------------------*/
+
+void reset_admission() {
+  if (!memory_limit) return;
+
+  msg(1, "  Predicted peak:  %.1f MB", (base_memory + predicted_peak) /
+    (1 << 20));
+  msg(1, "  Correction:      %.2f", correction);
+  memory_limit = 0;
+  reserved.clear();
+}
+/*------------------------------------------------------------------------*/
@@ -0,0 +1,167 @@
+/*------------------------------------------------------------------------*/
+/*! \file scheduler.h
+    \brief contains the work-stealing scheduler of parallel batches
+
+  The jobs of a batch are sorted by predicted cost, largest first, and
+  dealt round-robin to one deque per worker. A worker takes the largest
+  job of its own deque and, when it runs empty, steals the smallest job of
+  the worker with the largest remaining predicted cost.
+
+  In a campaign with a time budget the jobs are not known in advance,
+  they are created on demand until the deadline, cycling through the
+  widths or sampling them.
+
+  With a memory limit a job is admitted only when the predicted peak memory
+  of all running jobs fits into the limit, otherwise its worker releases
+  the memory it keeps for reuse and waits. A worker finishing a job while
+  others wait releases its memory and reservation as well. The predictions
+  are corrected by the ratio of the measured maximum resident set size to
+  the predicted peak, which is lowered only while no other job runs.
+
+  Part of MultAIGenFuzzer: Generation-Based AIG Fuzzer for Multipliers
+  Copyright(C) 2022 Daniela Kaufmann, Johannes Kepler University Linz
+*/
+/*------------------------------------------------------------------------*/
+#ifndef AIGENFUZZER_SRC_SCHEDULER_H_
+#define AIGENFUZZER_SRC_SCHEDULER_H_
+/*------------------------------------------------------------------------*/
+#include <stddef.h>
+
+#include <set>
+#include <vector>
+/*------------------------------------------------------------------------*/
+
+/**
+    One instance of a batch
+*/
+struct batch_job {
+  unsigned width;     // /< input bit-width
+  unsigned index;     // /< index of the instance for its width, gives seed
+  unsigned number;    // /< number of the job in the batch, used by shards
+  unsigned sequence;  // /< position in the schedule, order of the archive
+  double cost;        // /< predicted cost
+};
+
+/**
+    Predicts the cost of generating and writing a multiplier, the number of
+    gates grows quadratically, the slice updates add a small cubic part
+
+    @param width input bit-width
+
+    @return double
+*/
+double predicted_cost(unsigned width);
+
+/**
+    Sorts 'jobs' largest first, sets their sequence and deals them to the
+    deques of 'workers' workers
+
+    @param jobs jobs of the batch, sorted in place
+    @param workers number of workers
+*/
+void init_scheduler(std::vector<batch_job> & jobs, unsigned workers);
+
+/**
+    Takes the next job of 'worker', stealing from other workers if its
+    own deque is empty
+
+    @param worker index of the worker
+    @param job set to the next job
+
+    @return false if all jobs are taken or a stop signal was caught
+*/
+bool next_batch_job(unsigned worker, batch_job * job);
+
+/**
+    Starts a campaign: instead of the dealt jobs, 'next_batch_job' creates
+    jobs until 'seconds' of wall-clock time passed. Job 'number' of the
+    campaign is instance 'number / widths' of width 'number % widths', or,
+    when sampling, instance 'number' of a width drawn uniformly from
+    'widths' by a hash of 'seed' and 'number'. Only the jobs 'number' with
+    'number % shards == shard' are created.
+
+    @param widths input bit-widths, a width given twice is drawn twice as
+                  often
+    @param seconds time budget
+    @param sample draws the widths instead of cycling through them
+    @param seed seed of the batch
+    @param shard index of the shard
+    @param shards number of shards
+*/
+void init_campaign(const std::vector<unsigned> & widths, double seconds,
+                   bool sample, unsigned seed, unsigned shard,
+                   unsigned shards);
+
+/**
+    Sets 'job' to the job 'number' of the campaign
+
+    @param number number of the job
+    @param job receives width, index and number
+*/
+void campaign_job(unsigned number, batch_job * job);
+
+/**
+    Lets the campaign skip the jobs 'numbers', finished by an earlier run
+
+    @param numbers numbers of finished jobs
+*/
+void skip_campaign_jobs(const std::set<unsigned> & numbers);
+
+/**
+    Number of jobs created by the campaign
+
+    @return unsigned
+*/
+unsigned campaign_jobs();
+
+/**
+    Deallocates the deques and ends the campaign
+*/
+void reset_scheduler();
+
+/**
+    Enables admission control of 'workers' workers, 0 disables it
+
+    @param limit memory limit in bytes
+    @param workers number of workers
+*/
+void init_admission(size_t limit, unsigned workers);
+
+/**
+    Blocks until the job of 'worker' with predicted peak memory 'bytes' fits
+    into the memory limit. Before waiting 'release' is called to free the
+    memory kept by the worker. A job is always admitted if no other job is
+    running.
+
+    @param worker index of the worker
+    @param bytes predicted peak memory of the job
+    @param release deallocates the memory kept by the worker
+*/
+void admit_job(unsigned worker, double bytes, void (*release)());
+
+/**
+    Updates the correction of the predictions after a job of 'worker' and
+    wakes the waiting workers. If a worker waits, 'release' is called and
+    the reservation of 'worker' is given up, otherwise it is kept for the
+    next job.
+
+    @param worker index of the worker
+    @param release deallocates the memory kept by the worker, 0 if the
+                   memory of the job is still in use
+*/
+void finish_admitted_job(unsigned worker, void (*release)());
+
+/**
+    Removes 'worker' from the admission control after its last job
+
+    @param worker index of the worker
+*/
+void leave_admission(unsigned worker);
+
+/**
+    Prints the predicted peak memory and its correction, disables admission
+    control
+*/
+void reset_admission();
+
+#endif  // AIGENFUZZER_SRC_SCHEDULER_H_
@@ -9,6 +9,8 @@
 
 #include "signal_statistics.h"
 
+#include <atomic>
+
 /*------------------------------------------------------------------------*/
 // Global variable
 int verbose = 1;
@@ -18,6 +20,19 @@ void(*original_SIGSEGV_handler)(int);
 void(*original_SIGABRT_handler)(int);
 void(*original_SIGTERM_handler)(int);
 
+volatile sig_atomic_t stop_signal;
+
+/*------------------------------------------------------------------------*/
+// Local variables
+
+static struct timespec start_time;           // /< of 'wall_clock_time'
+
+static volatile sig_atomic_t graceful_stop;  // /< see 'enable_graceful_stop'
+
+static std::atomic<uint64_t> instances;      // /< written instances
+static std::atomic<uint64_t> written_ands;   // /< their AND gates
+static std::atomic<uint64_t> written_bytes;  // /< their files
+
 /*------------------------------------------------------------------------*/
 
 const char * signal_name(int sig) {
@@ -32,6 +47,10 @@ const char * signal_name(int sig) {
 
 /*------------------------------------------------------------------------*/
 static void catch_signal(int sig) {
+  if ((sig == SIGINT || sig == SIGTERM) && graceful_stop && !stop_signal) {
+    stop_signal = sig;
+    return;
+  }
   printf("c\nc caught signal '%s'(%d)\nc\n", signal_name(sig), sig);
   printf("c\nc raising signal '%s'(%d) again\n", signal_name(sig), sig);
   reset_all_signal_handlers();
@@ -42,6 +61,7 @@ static void catch_signal(int sig) {
 /*------------------------------------------------------------------------*/
 
 void init_all_signal_handers() {
+  clock_gettime(CLOCK_MONOTONIC, &start_time);
   original_SIGINT_handler  = signal(SIGINT,  catch_signal);
   original_SIGSEGV_handler = signal(SIGSEGV, catch_signal);
   original_SIGABRT_handler = signal(SIGABRT, catch_signal);
@@ -60,17 +80,35 @@ void reset_all_signal_handlers() {
 }
 
 
+/*------------------------------------------------------------------------*/
+
+void enable_graceful_stop() {
+  graceful_stop = 1;
+}
+
+/*------------------------------------------------------------------------*/
+
+void raise_stop_signal() {
+  if (!stop_signal) return;
+  msg(1, "raising signal '%s'(%d) again", signal_name(stop_signal),
+    stop_signal);
+  reset_all_signal_handlers();
+  raise(stop_signal);
+}
+
 /*------------------------------------------------------------------------*/
 
 void msg(int level, const char *fmt, ...) {
   va_list ap;
   if (verbose < level) return;
+  flockfile(stdout);  // keeps lines of parallel batch threads apart
   fputs_unlocked("[maf] ", stdout);
   va_start(ap, fmt);
   vfprintf(stdout, fmt, ap);
   va_end(ap);
   fputc_unlocked('\n', stdout);
   fflush(stdout);
+  funlockfile(stdout);
 }
 
 /*------------------------------------------------------------------------*/
@@ -113,6 +151,31 @@ double process_time() {
 
 /*------------------------------------------------------------------------*/
 
+double thread_time() {
+  struct timespec ts;
+  if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts)) return 0;
+  return ts.tv_sec + 1e-9 * ts.tv_nsec;
+}
+
+/*------------------------------------------------------------------------*/
+
+double wall_clock_time() {
+  struct timespec ts;
+  if (clock_gettime(CLOCK_MONOTONIC, &ts)) return 0;
+  return ts.tv_sec - start_time.tv_sec +
+         1e-9 * (ts.tv_nsec - start_time.tv_nsec);
+}
+
+/*------------------------------------------------------------------------*/
+
+void count_instance(uint64_t ands, uint64_t bytes) {
+  instances++;
+  written_ands += ands;
+  written_bytes += bytes;
+}
+
+/*------------------------------------------------------------------------*/
+
 void print_statistics() {
   msg(1,"");
   msg(1,"Statistics");
@@ -124,5 +187,15 @@ void print_statistics() {
   msg(1,"  used time for reseting:        %15.2f seconds",
       reset_time - init_time);
   msg(1,"  total process time:            %15.2f seconds",  process_time());
+  if (instances > 1) {
+    double wall = wall_clock_time();
+    msg(1,"  elapsed wall-clock time:       %15.2f seconds", wall);
+    msg(1,"  written instances:             %15llu",
+      static_cast<unsigned long long>(instances));
+    msg(1,"  instances per second:          %15.2f", instances / wall);
+    msg(1,"  gates per second:              %15.0f", written_ands / wall);
+    msg(1,"  written MB per second:         %15.2f",
+      written_bytes / wall / (1 << 20));
+  }
   msg(1,"____________________________________________________________________");
 }
@@ -13,6 +13,8 @@
 #include <signal.h>
 #include <sys/time.h>
 #include <sys/resource.h>
+#include <stdint.h>
+#include <time.h>
 
 #include <iostream>
 /*------------------------------------------------------------------------*/
@@ -42,6 +44,21 @@ void init_all_signal_handers();
 */
 void reset_all_signal_handlers();
 
+// / SIGINT or SIGTERM which requested to stop the batch, 0 if none
+extern volatile sig_atomic_t stop_signal;
+
+/**
+    Lets the first SIGINT or SIGTERM only set 'stop_signal', so the batch
+    can finish the instances in flight and write its manifest. A second
+    signal terminates immediately.
+*/
+void enable_graceful_stop();
+
+/**
+    Raises the signal in 'stop_signal' again after the batch has stopped
+*/
+void raise_stop_signal();
+
 /*------------------------------------------------------------------------*/
 /**
     Prints an error message to stderr and exits the program
@@ -72,6 +89,26 @@ size_t maximum_resident_set_size();
 */
 double process_time();
 
+/**
+    Determines the process time used by the calling thread
+*/
+double thread_time();
+
+/**
+    Determines the elapsed wall-clock time since the signal handlers were
+    initialized
+*/
+double wall_clock_time();
+
+/**
+    Counts a written instance for the throughput printed by
+    'print_statistics', called by parallel threads
+
+    @param ands number of AND gates of the instance
+    @param bytes number of bytes written
+*/
+void count_instance(uint64_t ands, uint64_t bytes);
+
 /**
     Print statistics of maximum memory and used process time depending on
     selected modus
@@ -0,0 +1,708 @@
+/*------------------------------------------------------------------------*/
+/*! \file simulate.cpp
+    \brief contains the bit-parallel simulation checking generated models
+
+  Part of MultAIGenFuzzer: Generation-Based AIG Fuzzer for Multipliers
+  Copyright(C) 2022 Daniela Kaufmann, Johannes Kepler University Linz
+*/
+/*------------------------------------------------------------------------*/
+#include "simulate.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <thread>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SIMD_KERNELS
+#endif
+/*------------------------------------------------------------------------*/
+// Local Variables
+
+static const char * kernel_names[] = { "portable", "avx2", "avx512" };
+
+static simulation_kernel kernel = portable_kernel;  // /< selected kernel
+
+// / Gates between prefetching the inputs of a gate and simulating it. The
+// / inputs of a gate are often far apart, without prefetching the sweep
+// / waits for memory at almost every gate.
+static const unsigned prefetch_distance = 16;
+
+// / Bit 'k' of the index 'j' of the patterns of a word, for k < 6
+static const uint64_t pattern_bits[6] = {
+  0xaaaaaaaaaaaaaaaaull, 0xccccccccccccccccull, 0xf0f0f0f0f0f0f0f0ull,
+  0xff00ff00ff00ff00ull, 0xffff0000ffff0000ull, 0xffffffff00000000ull
+};
+
+// / Blocks taken at once by a thread of 'check_exhaustive'
+static const uint64_t exhaustive_chunk = 16;
+
+// / Increment of the state of 'next_random' per number
+static const uint64_t random_increment = 0x9e3779b97f4a7c15ull;
+
+static unsigned check_error = 51;
+static unsigned kernel_error = 52;
+static unsigned memory_error = 41;
+/*------------------------------------------------------------------------*/
+
+/**
+    Widest kernel supported by the CPU
+*/
+static simulation_kernel detect_kernel() {
+#ifdef SIMD_KERNELS
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f")) return avx512_kernel;
+  if (__builtin_cpu_supports("avx2")) return avx2_kernel;
+#endif
+  return portable_kernel;
+}
+
+/*------------------------------------------------------------------------*/
+
+void select_simulation_kernel(const char * name) {
+  simulation_kernel supported = detect_kernel();
+  if (!name) {
+    kernel = supported;
+    return;
+  }
+  unsigned k = 0;
+  while (k <= avx512_kernel && strcmp(name, kernel_names[k])) k++;
+  if (k > avx512_kernel)
+    die(kernel_error, "unknown simulation kernel '%s'", name);
+  if (k > supported)
+    die(kernel_error, "simulation kernel '%s' is not supported by this CPU",
+      name);
+  kernel = static_cast<simulation_kernel>(k);
+}
+
+/*------------------------------------------------------------------------*/
+
+const char * simulation_kernel_name() {
+  return kernel_names[kernel];
+}
+
+/*------------------------------------------------------------------------*/
+
+uint64_t * allocate_words(size_t count) {
+  void * res = 0;
+  if (posix_memalign(&res, 64, count * sizeof(uint64_t)))
+    die(memory_error, "out of memory allocating %zu simulation words", count);
+  return static_cast<uint64_t *>(res);
+}
+
+/*------------------------------------------------------------------------*/
+
+unsigned simulation_words(uint64_t patterns) {
+  unsigned res = 1;
+  while (res < max_simulation_words && 64 * res < patterns) res *= 2;
+  return res;
+}
+
+/*------------------------------------------------------------------------*/
+
+uint64_t simulated_patterns(uint64_t patterns) {
+  uint64_t block = 64 * simulation_words(patterns);
+  return (patterns + block - 1) / block * block;
+}
+
+/*------------------------------------------------------------------------*/
+
+/**
+    Copies the gates of 'm' in the order given by 'order' into 'sm' and
+    renumbers their variables
+*/
+static void renumber_gates(simulation_model * sm, const aiger * m,
+                           const std::vector<unsigned> & order) {
+  std::vector<unsigned> map(m->maxvar + 1, 0);
+  for (unsigned k = 0; k < m->num_inputs; k++)
+    map[aiger_lit2var(m->inputs[k].lit)] = k + 1;
+  unsigned first = 2 * sm->width + 1;
+  for (size_t i = 0; i < order.size(); i++)
+    map[aiger_lit2var(m->ands[order[i]].lhs)] = first + i;
+
+  sm->rhs0.resize(order.size());
+  sm->rhs1.resize(order.size());
+  for (size_t i = 0; i < order.size(); i++) {
+    const aiger_and * g = m->ands + order[i];
+    sm->rhs0[i] = 2 * map[aiger_lit2var(g->rhs0)] + aiger_sign(g->rhs0);
+    sm->rhs1[i] = 2 * map[aiger_lit2var(g->rhs1)] + aiger_sign(g->rhs1);
+  }
+  sm->outputs.resize(m->num_outputs);
+  for (unsigned k = 0; k < m->num_outputs; k++)
+    sm->outputs[k] = 2 * map[aiger_lit2var(m->outputs[k].lit)] +
+                     aiger_sign(m->outputs[k].lit);
+}
+
+/*------------------------------------------------------------------------*/
+
+/**
+    Sorts the gates of 'm' by column and within a column by level into
+    'order', stores their levels in 'levels' and the end of each column in
+    'columns'. Input a_i and b_i belong to column 'i', a gate of two inputs
+    to the sum of their columns, as the partial products, any other gate to
+    the largest column of its inputs. Hence the inputs of a gate belong to
+    its column or a column before and the order is topological.
+*/
+static void levelize(const aiger * m, unsigned width,
+                     std::vector<unsigned> * order,
+                     std::vector<unsigned> * levels,
+                     std::vector<size_t> * columns) {
+  std::vector<unsigned> level(m->maxvar + 1, 0), column(m->maxvar + 1, 0);
+  std::vector<bool> input(m->maxvar + 1, 0);
+  for (unsigned k = 0; k < m->num_inputs; k++) {
+    unsigned var = aiger_lit2var(m->inputs[k].lit);
+    column[var] = k % width;
+    input[var] = 1;
+  }
+
+  unsigned max_level = 0, max_column = 0;
+  for (unsigned i = 0; i < m->num_ands; i++) {
+    const aiger_and * g = m->ands + i;
+    unsigned var = aiger_lit2var(g->lhs);
+    unsigned var0 = aiger_lit2var(g->rhs0), var1 = aiger_lit2var(g->rhs1);
+    level[var] = std::max(level[var0], level[var1]) + 1;
+    column[var] = input[var0] && input[var1] ? column[var0] + column[var1]
+                  : std::max(column[var0], column[var1]);
+    max_level = std::max(max_level, level[var]);
+    max_column = std::max(max_column, column[var]);
+  }
+
+  // stable counting sorts, by level first and then by column
+  std::vector<unsigned> by_level(m->num_ands);
+  std::vector<size_t> count(max_level + 2, 0);
+  for (unsigned i = 0; i < m->num_ands; i++)
+    count[level[aiger_lit2var(m->ands[i].lhs)]]++;
+  for (unsigned l = 1; l <= max_level + 1; l++) count[l] += count[l - 1];
+  for (unsigned i = 0; i < m->num_ands; i++)
+    by_level[count[level[aiger_lit2var(m->ands[i].lhs)] - 1]++] = i;
+
+  columns->assign(m->num_ands ? max_column + 1 : 0, 0);
+  for (unsigned i = 0; i < m->num_ands; i++)
+    (*columns)[column[aiger_lit2var(m->ands[i].lhs)]]++;
+  for (size_t c = 1; c < columns->size(); c++)
+    (*columns)[c] += (*columns)[c - 1];
+  count.assign(columns->size() + 1, 0);
+  for (size_t c = 1; c < columns->size(); c++) count[c] = (*columns)[c - 1];
+  order->resize(m->num_ands);
+  levels->resize(m->num_ands);
+  for (unsigned i = 0; i < m->num_ands; i++) {
+    unsigned var = aiger_lit2var(m->ands[by_level[i]].lhs);
+    size_t position = count[column[var]]++;
+    (*order)[position] = by_level[i];
+    (*levels)[position] = level[var];
+  }
+}
+
+/*------------------------------------------------------------------------*/
+
+void init_simulation_model(simulation_model * sm, const aiger * m,
+                           unsigned width, bool levelized) {
+  assert(m->num_inputs == 2 * width);
+  assert(m->num_outputs == 2 * width || m->num_outputs == 1);
+  sm->width = width;
+  sm->levelized = levelized;
+  sm->miter = m->num_outputs == 1;
+  std::vector<unsigned> order;
+  if (levelized) {
+    levelize(m, width, &order, &sm->levels, &sm->columns);
+  } else {
+    order.resize(m->num_ands);
+    for (unsigned i = 0; i < m->num_ands; i++) order[i] = i;
+    sm->levels.clear();
+    sm->columns.clear();
+  }
+  renumber_gates(sm, m, order);
+}
+
+/*------------------------------------------------------------------------*/
+
+size_t simulation_variables(const simulation_model * sm) {
+  return 2 * sm->width + 1 + sm->rhs0.size();
+}
+
+/*------------------------------------------------------------------------*/
+
+/**
+    Mask complementing the words of negative literal 'lit'
+*/
+static inline uint64_t literal_mask(unsigned lit) {
+  return -static_cast<uint64_t>(lit & 1);
+}
+
+/**
+    Word 'w' of literal 'lit', complemented for negative literals
+*/
+static inline uint64_t literal_word(const uint64_t * values, unsigned words,
+                                    unsigned lit, unsigned w) {
+  return values[aiger_lit2var(lit) * words + w] ^ literal_mask(lit);
+}
+
+/**
+    Prefetches the blocks of the inputs of the gate 'prefetch_distance'
+    gates after 'g', a block is at most one cache line
+*/
+static inline void prefetch_inputs(const uint64_t * values, unsigned words,
+                                   const simulation_model * sm, size_t g,
+                                   size_t end) {
+  if (g + prefetch_distance >= end) return;
+  g += prefetch_distance;
+  __builtin_prefetch(values + aiger_lit2var(sm->rhs0[g]) * words);
+  __builtin_prefetch(values + aiger_lit2var(sm->rhs1[g]) * words);
+}
+
+/*------------------------------------------------------------------------*/
+
+/**
+    Simulates the gates 'begin' to 'end - 1' of 'sm'
+*/
+static void simulate_portable(const simulation_model * sm, size_t begin,
+                              size_t end, uint64_t * values,
+                              unsigned words) {
+  uint64_t * lhs = values + (2 * sm->width + 1 + begin) * words;
+  for (size_t g = begin; g != end; g++, lhs += words) {
+    prefetch_inputs(values, words, sm, g, end);
+    unsigned lit0 = sm->rhs0[g], lit1 = sm->rhs1[g];
+    const uint64_t * rhs0 = values + aiger_lit2var(lit0) * words;
+    const uint64_t * rhs1 = values + aiger_lit2var(lit1) * words;
+    uint64_t mask0 = literal_mask(lit0), mask1 = literal_mask(lit1);
+    for (unsigned w = 0; w < words; w++)
+      lhs[w] = (rhs0[w] ^ mask0) & (rhs1[w] ^ mask1);
+  }
+}
+
+/*------------------------------------------------------------------------*/
+#ifdef SIMD_KERNELS
+
+__attribute__((target("avx2")))
+static void simulate_avx2(const simulation_model * sm, size_t begin,
+                          size_t end, uint64_t * values, unsigned words) {
+  assert(!(words % 4));
+  uint64_t * lhs = values + (2 * sm->width + 1 + begin) * words;
+  for (size_t g = begin; g != end; g++, lhs += words) {
+    prefetch_inputs(values, words, sm, g, end);
+    unsigned lit0 = sm->rhs0[g], lit1 = sm->rhs1[g];
+    const uint64_t * rhs0 = values + aiger_lit2var(lit0) * words;
+    const uint64_t * rhs1 = values + aiger_lit2var(lit1) * words;
+    __m256i mask0 = _mm256_set1_epi64x(literal_mask(lit0));
+    __m256i mask1 = _mm256_set1_epi64x(literal_mask(lit1));
+    for (unsigned w = 0; w < words; w += 4) {
+      __m256i x = _mm256_load_si256(
+        reinterpret_cast<const __m256i *>(rhs0 + w));
+      __m256i y = _mm256_load_si256(
+        reinterpret_cast<const __m256i *>(rhs1 + w));
+      x = _mm256_and_si256(_mm256_xor_si256(x, mask0),
+                           _mm256_xor_si256(y, mask1));
+      _mm256_store_si256(reinterpret_cast<__m256i *>(lhs + w), x);
+    }
+  }
+}
+
+/*------------------------------------------------------------------------*/
+
+__attribute__((target("avx512f")))
+static void simulate_avx512(const simulation_model * sm, size_t begin,
+                            size_t end, uint64_t * values, unsigned words) {
+  assert(!(words % 8));
+  uint64_t * lhs = values + (2 * sm->width + 1 + begin) * words;
+  for (size_t g = begin; g != end; g++, lhs += words) {
+    prefetch_inputs(values, words, sm, g, end);
+    unsigned lit0 = sm->rhs0[g], lit1 = sm->rhs1[g];
+    const uint64_t * rhs0 = values + aiger_lit2var(lit0) * words;
+    const uint64_t * rhs1 = values + aiger_lit2var(lit1) * words;
+    __m512i mask0 = _mm512_set1_epi64(literal_mask(lit0));
+    __m512i mask1 = _mm512_set1_epi64(literal_mask(lit1));
+    for (unsigned w = 0; w < words; w += 8) {
+      __m512i x = _mm512_load_si512(rhs0 + w);
+      __m512i y = _mm512_load_si512(rhs1 + w);
+      x = _mm512_and_si512(_mm512_xor_si512(x, mask0),
+                           _mm512_xor_si512(y, mask1));
+      _mm512_store_si512(lhs + w, x);
+    }
+  }
+}
+
+#endif
+/*------------------------------------------------------------------------*/
+
+/**
+    Simulates the gates 'begin' to 'end - 1' of 'sm' with the selected
+    kernel
+*/
+static void simulate_gates(const simulation_model * sm, size_t begin,
+                           size_t end, uint64_t * values, unsigned words) {
+#ifdef SIMD_KERNELS
+  if (kernel == avx512_kernel && !(words % 8))
+    return simulate_avx512(sm, begin, end, values, words);
+  if (kernel >= avx2_kernel && !(words % 4))
+    return simulate_avx2(sm, begin, end, values, words);
+#endif
+  simulate_portable(sm, begin, end, values, words);
+}
+
+/*------------------------------------------------------------------------*/
+
+/**
+    State shared by the threads simulating the columns of a model
+*/
+struct column_sweep {
+  const simulation_model * sm;      // /< simulated model
+  uint64_t * values;                // /< words of the variables
+  unsigned words;                   // /< words per variable
+  unsigned threads;                 // /< number of threads
+  std::vector<std::atomic<unsigned> > done;  // /< levels before 'done[c]'
+                                             //    of columns up to 'c' are
+                                             //    simulated
+};
+
+// / Value of 'column_sweep::done' of a finished column
+static const unsigned all_levels = ~0u;
+
+/*------------------------------------------------------------------------*/
+
+/**
+    Thread 't' of 'sweep', simulates every 'threads'-th column. The gates
+    of a level are simulated once the column before has finished the
+    levels below, hence the threads follow each other in a wavefront and
+    the gates of one level are simulated by several threads.
+*/
+static void run_columns(column_sweep * sweep, unsigned t) {
+  const simulation_model * sm = sweep->sm;
+  for (size_t c = t; c < sm->columns.size(); c += sweep->threads) {
+    size_t g = c ? sm->columns[c - 1] : 0, end = sm->columns[c];
+    unsigned ready = c ? sweep->done[c - 1].load() : all_levels;
+    while (g < end) {
+      while (ready < sm->levels[g]) {
+        std::this_thread::yield();
+        ready = sweep->done[c - 1];
+      }
+      size_t next = g;
+      while (next < end && sm->levels[next] <= ready) next++;
+      simulate_gates(sm, g, next, sweep->values, sweep->words);
+      g = next;
+      sweep->done[c] = std::min(g < end ? sm->levels[g] : all_levels, ready);
+    }
+    while (ready != all_levels) {
+      std::this_thread::yield();
+      ready = sweep->done[c - 1];
+    }
+    sweep->done[c] = all_levels;
+  }
+}
+
+/*------------------------------------------------------------------------*/
+
+void simulate_model(const simulation_model * sm, uint64_t * values,
+                    unsigned words, unsigned threads) {
+  for (unsigned w = 0; w < words; w++) values[w] = 0;  // constant
+  size_t gates = sm->rhs0.size();
+  if (!sm->levelized || threads <= 1 || gates < parallel_gates) {
+    simulate_gates(sm, 0, gates, values, words);
+    return;
+  }
+
+  column_sweep sweep;
+  sweep.sm = sm;
+  sweep.values = values;
+  sweep.words = words;
+  sweep.threads = threads;
+  std::vector<std::atomic<unsigned> > done(sm->columns.size());
+  sweep.done.swap(done);
+  for (size_t c = 0; c < sweep.done.size(); c++) sweep.done[c] = 0;
+  std::vector<std::thread> workers;
+  for (unsigned t = 1; t < threads; t++)
+    workers.push_back(std::thread(run_columns, &sweep, t));
+  run_columns(&sweep, 0);
+  for (size_t t = 0; t < workers.size(); t++) workers[t].join();
+}
+
+/*------------------------------------------------------------------------*/
+
+void reference_product(unsigned width, const uint64_t * a,
+                       const uint64_t * b, uint64_t * product,
+                       unsigned words) {
+  assert(words <= max_simulation_words);
+  for (unsigned k = 0; k < 2 * width * words; k++) product[k] = 0;
+
+  // adds row 'a * b_i' at column 'i' with a bit-sliced ripple-carry adder,
+  // the words of a block are independent and added in the innermost loop
+  uint64_t carry[max_simulation_words];
+  for (unsigned i = 0; i < width; i++) {
+    const uint64_t * bit = b + i * words;
+    for (unsigned w = 0; w < words; w++) carry[w] = 0;
+    for (unsigned k = 0; k < width; k++) {
+      uint64_t * sum = product + (i + k) * words;
+      const uint64_t * row = a + k * words;
+      for (unsigned w = 0; w < words; w++) {
+        uint64_t x = row[w] & bit[w], half = sum[w] ^ x;
+        uint64_t next = (sum[w] & x) | (carry[w] & half);
+        sum[w] = half ^ carry[w];
+        carry[w] = next;
+      }
+    }
+    for (unsigned k = i + width; k < 2 * width; k++) {
+      uint64_t * sum = product + k * words, any = 0;
+      for (unsigned w = 0; w < words; w++) {
+        uint64_t next = sum[w] & carry[w];
+        sum[w] ^= carry[w];
+        any |= carry[w] = next;
+      }
+      if (!any) break;
+    }
+  }
+}
+
+/*------------------------------------------------------------------------*/
+
+bool find_mismatch(const simulation_model * sm, const uint64_t * values,
+                   const uint64_t * product, unsigned words,
+                   unsigned * pattern) {
+  for (unsigned w = 0; w < words; w++) {
+    uint64_t mask = 0;
+    for (unsigned k = 0; k < sm->outputs.size(); k++)
+      mask |= literal_word(values, words, sm->outputs[k], w) ^
+              (sm->miter ? 0 : product[k * words + w]);
+    if (mask) {
+      *pattern = 64 * w + __builtin_ctzll(mask);
+      return 1;
+    }
+  }
+  return 0;
+}
+
+/*------------------------------------------------------------------------*/
+
+std::string pattern_hex(const uint64_t * blocks, unsigned bits,
+                        unsigned words, unsigned pattern) {
+  std::string res;
+  unsigned w = pattern / 64, shift = pattern % 64;
+  for (unsigned digit = (bits + 3) / 4; digit--; ) {
+    unsigned x = 0;
+    for (unsigned i = 4; i--; ) {
+      unsigned bit = 4 * digit + i;
+      x = 2 * x + (bit < bits ? (blocks[bit * words + w] >> shift) & 1 : 0);
+    }
+    res += "0123456789abcdef"[x];
+  }
+  return res;
+}
+
+/*------------------------------------------------------------------------*/
+
+std::string describe_counterexample(const simulation_model * sm,
+                                   const uint64_t * values,
+                                   const uint64_t * product, unsigned words,
+                                   unsigned pattern) {
+  unsigned width = sm->width, outputs_count = sm->outputs.size();
+  const uint64_t * a = values + words, * b = values + (width + 1) * words;
+  std::vector<uint64_t> outputs(outputs_count * words);
+  for (unsigned w = 0; w < words; w++)
+    for (unsigned k = 0; k < outputs_count; k++)
+      outputs[k * words + w] = literal_word(values, words, sm->outputs[k], w);
+
+  return "         a = 0x" + pattern_hex(a, width, words, pattern) +
+         "\n         b = 0x" + pattern_hex(b, width, words, pattern) +
+         "\n         expected product 0x" +
+         pattern_hex(product, 2 * width, words, pattern) +
+         (sm->miter ? "\n         miter output " :
+                      "\n         simulated output 0x") +
+         pattern_hex(&outputs[0], outputs_count, words, pattern);
+}
+
+/*------------------------------------------------------------------------*/
+
+void report_counterexample(const simulation_model * sm,
+                           const uint64_t * values, const uint64_t * product,
+                           unsigned words, unsigned pattern) {
+  die(check_error, "generated multiplier is wrong for input\n%s",
+    describe_counterexample(sm, values, product, words, pattern).c_str());
+}
+
+/*------------------------------------------------------------------------*/
+
+uint64_t next_random(uint64_t * state) {
+  uint64_t x = (*state += random_increment);
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+  return x ^ (x >> 31);
+}
+
+/*------------------------------------------------------------------------*/
+
+void set_random_inputs(const simulation_model * sm, unsigned words,
+                       uint64_t * state, uint64_t * values) {
+  uint64_t * a = values + words, * b = values + (sm->width + 1) * words;
+  for (unsigned i = 0; i < sm->width; i++)
+    for (unsigned w = 0; w < words; w++) {
+      a[i * words + w] = next_random(state);
+      b[i * words + w] = next_random(state);
+    }
+}
+
+/*------------------------------------------------------------------------*/
+
+/**
+    State shared by the threads of 'check_random' and 'check_exhaustive'.
+    The threads take blocks in increasing order and finish the blocks they
+    took, hence the smallest wrong pattern is found independently of the
+    number of threads.
+*/
+struct block_check {
+  const simulation_model * sm;      // /< checked model
+  bool exhaustive;                  // /< all patterns, else random ones
+  uint64_t seed;                    // /< seed of the random patterns
+  unsigned words;                   // /< words per variable
+  unsigned threads;                 // /< threads simulating one block
+  uint64_t blocks;                  // /< blocks of '64 * words' patterns
+  uint64_t chunk;                   // /< blocks taken at once
+  std::atomic<uint64_t> next;       // /< next block to take
+  std::atomic<bool> failed;         // /< a mismatch was found
+  std::mutex mutex;                 // /< protects the following
+  uint64_t first_failure;           // /< smallest wrong pattern found
+  std::string counterexample;       // /< its description
+};
+
+/*------------------------------------------------------------------------*/
+
+/**
+    Sets the inputs of the patterns 'first' to 'first + 64 * words - 1',
+    pattern 'p' assigns a = p mod 2^n and b = p / 2^n
+*/
+static void set_exhaustive_inputs(unsigned width, unsigned words,
+                                  uint64_t first, uint64_t * values) {
+  for (unsigned k = 0; k < 2 * width; k++) {
+    uint64_t * x = values + (k + 1) * words;
+    for (unsigned w = 0; w < words; w++) {
+      uint64_t p = first + 64 * w;
+      x[w] = k < 6 ? pattern_bits[k] : -static_cast<uint64_t>((p >> k) & 1);
+    }
+  }
+}
+
+/*------------------------------------------------------------------------*/
+
+/**
+    Thread of a 'block_check' with its own value array, takes chunks of
+    blocks until all are simulated or a mismatch is found. The random
+    patterns of a block are those of a sequential run: each block draws
+    '2 n words' numbers and the generator state only adds a constant per
+    number, hence the state of a block is computed directly.
+*/
+static void run_blocks(block_check * check) {
+  const simulation_model * sm = check->sm;
+  unsigned width = sm->width, words = check->words;
+  uint64_t * values = allocate_words(simulation_variables(sm) * words);
+  const uint64_t * a = values + words, * b = values + (width + 1) * words;
+  std::vector<uint64_t> product(2 * width * words);
+
+  while (!check->failed) {
+    uint64_t start = check->next.fetch_add(check->chunk);
+    if (start >= check->blocks) break;
+    uint64_t end = std::min(start + check->chunk, check->blocks);
+    for (uint64_t block = start; block < end; block++) {
+      uint64_t first = block * 64 * words;
+      if (check->exhaustive) {
+        set_exhaustive_inputs(width, words, first, values);
+      } else {
+        uint64_t state = check->seed +
+                         block * 2 * width * words * random_increment;
+        set_random_inputs(sm, words, &state, values);
+      }
+      simulate_model(sm, values, words, check->threads);
+      reference_product(width, a, b, &product[0], words);
+      unsigned pattern;
+      if (!find_mismatch(sm, values, &product[0], words, &pattern)) continue;
+
+      std::lock_guard<std::mutex> lock(check->mutex);
+      if (!check->failed || first + pattern < check->first_failure) {
+        check->first_failure = first + pattern;
+        check->counterexample = describe_counterexample(sm, values, &product[0],
+                                                     words, pattern);
+      }
+      check->failed = 1;
+      break;
+    }
+  }
+  free(values);
+}
+
+/*------------------------------------------------------------------------*/
+
+/**
+    Runs 'check' on 'arrays' threads with their own value array, each
+    simulating a block on 'check->threads' threads, and dies with the
+    counterexample of the smallest wrong pattern
+*/
+static void run_block_check(block_check * check, unsigned arrays) {
+  check->next = 0;
+  check->failed = 0;
+  check->first_failure = 0;
+  if (arrays <= 1) {
+    run_blocks(check);
+  } else {
+    std::vector<std::thread> workers;
+    for (unsigned t = 0; t < arrays; t++)
+      workers.push_back(std::thread(run_blocks, check));
+    for (unsigned t = 0; t < arrays; t++) workers[t].join();
+  }
+
+  if (check->failed)
+    die(check_error, "generated multiplier is wrong for input\n%s",
+      check->counterexample.c_str());
+}
+
+/*------------------------------------------------------------------------*/
+
+void check_random(const simulation_model * sm, uint64_t seed,
+                  uint64_t patterns, unsigned threads, unsigned arrays) {
+  double start = wall_clock_time();
+  block_check check;
+  check.sm = sm;
+  check.exhaustive = 0;
+  check.seed = seed;
+  check.words = simulation_words(patterns);
+  check.blocks = simulated_patterns(patterns) / (64 * check.words);
+  check.chunk = 1;
+
+  // threads left over by the value arrays simulate the columns of a block
+  if (arrays > threads) arrays = threads;
+  if (arrays > check.blocks) arrays = check.blocks;
+  if (!arrays) arrays = 1;
+  check.threads = threads / arrays;
+  run_block_check(&check, arrays);
+
+  msg(2, "  Checked %llu random patterns in %.3f seconds (%s%s) on %u "
+    "arrays of %u threads",
+    static_cast<unsigned long long>(64 * check.words * check.blocks),
+    wall_clock_time() - start, simulation_kernel_name(),
+    sm->levelized ? ", levelized" : "", arrays, check.threads);
+}
+
+/*------------------------------------------------------------------------*/
+
+void check_exhaustive(const simulation_model * sm, unsigned threads) {
+  assert(sm->width <= max_exhaustive_width);
+  double start = wall_clock_time();
+  uint64_t patterns = 1ull << (2 * sm->width);
+
+  block_check check;
+  check.sm = sm;
+  check.exhaustive = 1;
+  check.seed = 0;
+  check.words = simulation_words(patterns);
+  check.threads = 1;
+  check.blocks = simulated_patterns(patterns) / (64 * check.words);
+  check.chunk = exhaustive_chunk;
+
+  uint64_t chunks = (check.blocks + exhaustive_chunk - 1) / exhaustive_chunk;
+  if (threads > chunks) threads = chunks;
+  run_block_check(&check, threads);
+
+  msg(2, "  Checked all %llu input patterns in %.3f seconds on %u threads",
+    static_cast<unsigned long long>(patterns), wall_clock_time() - start,
+    threads ? threads : 1);
+}
+/*------------------------------------------------------------------------*/
@@ -0,0 +1,288 @@
+/*------------------------------------------------------------------------*/
+/*! \file simulate.h
+    \brief contains the bit-parallel simulation checking generated models
+
+  Each variable of the model gets a block of 1 to 8 machine words, bit 'j'
+  of word 'w' is its value under input pattern '64 w + j', hence one sweep
+  over the AND gates simulates up to 512 patterns. The blocks are aligned
+  to 64 bytes and stored by variable, a full block fills one cache line.
+  The gates are copied into a 'simulation_model', two arrays of input
+  literals with the variables renumbered so that gate 'g' defines variable
+  '2 n + 1 + g'. In generation order every gate follows its inputs and one
+  linear sweep suffices, but the fuzzer picks columns at random and the
+  inputs of consecutive gates are spread over the whole value array.
+  The levelized layout groups the gates by the column of the product they
+  belong to and sorts the gates of a column by level, hence most inputs of
+  a gate were computed shortly before and are still cached. Sorting all
+  gates by level instead spreads the inputs even further, since partial
+  products and sums are used many levels later. Threads simulate the
+  columns in a wavefront, a column proceeds to a level once the column
+  before has finished the levels below. The random check splits the
+  blocks of patterns over threads with private value arrays instead,
+  which scales better but needs a value array per thread. Both are
+  combined if there are fewer blocks than threads.
+
+  The sweep is done by a kernel selected at runtime: with AVX-512 one
+  instruction processes 8 words, with AVX2 4 words, otherwise a portable
+  loop over the words is used.
+
+  The outputs are compared with a reference product computed on the same
+  bit-sliced words: the shifted rows 'a & b_i' are added by a bit-sliced
+  ripple-carry adder, about 6 n^2 word operations, half as many as the
+  gates of the model counted in 'estimate.h'. A model with the single
+  output of a miter is correct if the output is 0 for every pattern.
+
+  Part of MultAIGenFuzzer: Generation-Based AIG Fuzzer for Multipliers
+  Copyright(C) 2022 Daniela Kaufmann, Johannes Kepler University Linz
+*/
+/*------------------------------------------------------------------------*/
+#ifndef AIGENFUZZER_SRC_SIMULATE_H_
+#define AIGENFUZZER_SRC_SIMULATE_H_
+/*------------------------------------------------------------------------*/
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "aig.h"
+/*------------------------------------------------------------------------*/
+
+// / Maximal number of words per variable, 512 patterns in one cache line
+static const unsigned max_simulation_words = 8;
+
+// / Maximal width checked by 'check_exhaustive', 2^24 patterns
+static const unsigned max_exhaustive_width = 12;
+
+// / Gates of the smallest model simulated by several threads
+static const size_t parallel_gates = 1 << 16;
+
+/**
+    Gates of a model in the layout of the simulation. Variables 1 to
+    '2 * width' are the inputs a_0..a_{n-1}, b_0..b_{n-1}, gate 'g' defines
+    variable '2 * width + 1 + g'. A model with one output is a miter of
+    two multipliers.
+*/
+struct simulation_model {
+  unsigned width;                 // /< input bit-width
+  bool levelized;                 // /< gates are sorted by level
+  bool miter;                     // /< the output is 0 iff correct
+  std::vector<unsigned> rhs0;     // /< first input literal of each gate
+  std::vector<unsigned> rhs1;     // /< second input literal of each gate
+  std::vector<unsigned> outputs;  // /< literals of o_0..o_{2n-1}
+  std::vector<unsigned> levels;   // /< level of each gate, if levelized
+  std::vector<size_t> columns;    // /< end of the gates of each column,
+                                  //    if levelized
+};
+
+/**
+    Instruction sets of the simulation kernels
+*/
+enum simulation_kernel {
+  portable_kernel,  // /< plain loop over the words
+  avx2_kernel,      // /< 256-bit lanes
+  avx512_kernel     // /< 512-bit lanes
+};
+
+/**
+    Selects the kernel by name, 'portable', 'avx2' or 'avx512', or the
+    widest kernel supported by the CPU for 0. Dies if the CPU does not
+    support the named kernel.
+
+    @param name name of kernel or 0
+*/
+void select_simulation_kernel(const char * name);
+
+/**
+    Name of the selected kernel
+
+    @return const char *
+*/
+const char * simulation_kernel_name();
+
+/**
+    Allocates 'count' words aligned to 64 bytes, released with 'free'
+
+    @param count number of words
+
+    @return uint64_t *
+*/
+uint64_t * allocate_words(size_t count);
+
+/**
+    Number of words per variable used to simulate 'patterns' patterns,
+    a power of two up to 'max_simulation_words'
+
+    @param patterns number of patterns
+
+    @return unsigned
+*/
+unsigned simulation_words(uint64_t patterns);
+
+/**
+    Number of patterns simulated for 'patterns' patterns, rounded up to
+    full blocks of 'simulation_words'
+
+    @param patterns number of patterns
+
+    @return uint64_t
+*/
+uint64_t simulated_patterns(uint64_t patterns);
+
+/**
+    Copies the gates of 'm' into 'sm', in generation order or levelized
+
+    @param sm receives the gates
+    @param m generated model, inputs a_0..a_{n-1}, b_0..b_{n-1} and
+             outputs o_0..o_{2n-1} or the output of a miter, gates in
+             topological order
+    @param width input bit-width
+    @param levelized sorts the gates by level and column
+*/
+void init_simulation_model(simulation_model * sm, const aiger * m,
+                           unsigned width, bool levelized);
+
+/**
+    Number of variables of 'sm' including the constant
+
+    @param sm simulated model
+
+    @return size_t
+*/
+size_t simulation_variables(const simulation_model * sm);
+
+/**
+    Simulates the AND gates of 'sm' on '64 * words' patterns with the
+    selected kernel, levelized models on up to 'threads' threads
+
+    @param sm simulated model
+    @param values 'words' words per variable, the words of the inputs are set
+    @param words words per variable, 1, 2, 4 or 8
+    @param threads threads simulating the gates of a level
+*/
+void simulate_model(const simulation_model * sm, uint64_t * values,
+                    unsigned words, unsigned threads);
+
+/**
+    Computes the bit-sliced product of 'a' and 'b'
+
+    @param width input bit-width
+    @param a 'width' blocks of 'words' words, bit 'j' of word 'w' of block
+             'i' is bit 'i' of pattern '64 w + j'
+    @param b 'width' blocks
+    @param product receives '2 * width' blocks
+    @param words words per block
+*/
+void reference_product(unsigned width, const uint64_t * a,
+                       const uint64_t * b, uint64_t * product,
+                       unsigned words);
+
+/**
+    Compares the simulated outputs of 'sm' with the reference product,
+    the output of a miter with 0
+
+    @param sm simulated model
+    @param values words of the variables after 'simulate_model'
+    @param product bit-sliced reference product
+    @param words words per variable
+    @param pattern receives the first pattern with a wrong output
+
+    @return false if all outputs are correct
+*/
+bool find_mismatch(const simulation_model * sm, const uint64_t * values,
+                   const uint64_t * product, unsigned words,
+                   unsigned * pattern);
+
+/**
+    Returns pattern 'pattern' of the bit-sliced number 'blocks' in
+    hexadecimal
+
+    @param blocks bit-sliced number, 'bits' blocks of 'words' words
+    @param bits number of bits
+    @param words words per block
+    @param pattern index of the pattern
+
+    @return std::string
+*/
+std::string pattern_hex(const uint64_t * blocks, unsigned bits,
+                        unsigned words, unsigned pattern);
+
+/**
+    Describes inputs, expected and simulated product of 'pattern'
+
+    @param sm simulated model
+    @param values words of the variables after 'simulate_model'
+    @param product bit-sliced reference product
+    @param words words per variable
+    @param pattern wrong pattern
+
+    @return one line per number
+*/
+std::string describe_counterexample(const simulation_model * sm,
+                                   const uint64_t * values,
+                                   const uint64_t * product, unsigned words,
+                                   unsigned pattern);
+
+/**
+    Prints inputs, expected and simulated product of 'pattern' and dies
+
+    @param sm simulated model
+    @param values words of the variables after 'simulate_model'
+    @param product bit-sliced reference product
+    @param words words per variable
+    @param pattern wrong pattern
+*/
+void report_counterexample(const simulation_model * sm,
+                           const uint64_t * values, const uint64_t * product,
+                           unsigned words, unsigned pattern);
+
+/**
+    Returns the next number of the splitmix64 generator with 'state', the
+    generator of the random patterns
+
+    @param state state of the generator, initially the seed
+
+    @return uint64_t
+*/
+uint64_t next_random(uint64_t * state);
+
+/**
+    Sets the words of the inputs of 'sm' to the next random patterns
+
+    @param sm simulated model
+    @param words words per variable
+    @param state state of 'next_random'
+    @param values words of the variables
+*/
+void set_random_inputs(const simulation_model * sm, unsigned words,
+                       uint64_t * state, uint64_t * values);
+
+/**
+    Simulates 'sm' on 'simulated_patterns(patterns)' random input patterns
+    and dies with the counterexample of the smallest wrong pattern if an
+    output differs from the product of the inputs. The patterns only depend
+    on 'seed'. The blocks of patterns are taken by up to 'arrays' threads,
+    each with its own value array over the shared gates of 'sm'. The
+    threads left over simulate the columns of a levelized model, with
+    'arrays' 1 all threads share one value array.
+
+    @param sm simulated model
+    @param seed seed of the patterns
+    @param patterns number of patterns
+    @param threads number of threads
+    @param arrays maximal number of value arrays
+*/
+void check_random(const simulation_model * sm, uint64_t seed,
+                  uint64_t patterns, unsigned threads, unsigned arrays);
+
+/**
+    Simulates 'sm' on all 2^(2n) input patterns, split into blocks that are
+    taken by 'threads' threads, and dies with the counterexample of the
+    smallest wrong pattern found if an output differs from the product of
+    the inputs. The threads stop at the first mismatch.
+
+    @param sm simulated model, width at most 'max_exhaustive_width'
+    @param threads number of threads
+*/
+void check_exhaustive(const simulation_model * sm, unsigned threads);
+
+#endif  // AIGENFUZZER_SRC_SIMULATE_H_
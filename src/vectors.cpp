@@ -0,0 +1,127 @@
+/*------------------------------------------------------------------------*/
+/*! \file vectors.cpp
+    \brief contains the test vector files written with the instances
+
+  Part of MultAIGenFuzzer: Generation-Based AIG Fuzzer for Multipliers
+  Copyright(C) 2022 Daniela Kaufmann, Johannes Kepler University Linz
+*/
+/*------------------------------------------------------------------------*/
+#include "vectors.h"
+
+#include <stdlib.h>
+
+#include <algorithm>
+/*------------------------------------------------------------------------*/
+
+bool is_vector_file(const char * name) {
+  return has_suffix(name, ".vec") || has_suffix(name, ".stim");
+}
+
+/*------------------------------------------------------------------------*/
+
+/**
+    Bit 'i' of pattern 'pattern' of the bit-sliced number 'blocks'
+*/
+static inline unsigned pattern_bit(const uint64_t * blocks, unsigned words,
+                                   unsigned i, unsigned pattern) {
+  return (blocks[i * words + pattern / 64] >> (pattern % 64)) & 1;
+}
+
+/*------------------------------------------------------------------------*/
+
+/**
+    Writes 'bits' bits of pattern 'pattern' of 'blocks' to 's' in
+    little-endian bytes
+*/
+static void put_bytes(sink * s, const uint64_t * blocks, unsigned bits,
+                      unsigned words, unsigned pattern) {
+  for (unsigned i = 0; i < bits; i += 8) {
+    unsigned byte = 0;
+    for (unsigned k = 0; k < 8 && i + k < bits; k++)
+      byte |= pattern_bit(blocks, words, i + k, pattern) << k;
+    sink_put_ch(s, static_cast<char>(byte));
+  }
+}
+
+/*------------------------------------------------------------------------*/
+
+/**
+    Writes 'bits' bits of pattern 'pattern' of 'blocks' to 's' as '0' and
+    '1', least significant bit first
+*/
+static void put_digits(sink * s, const uint64_t * blocks, unsigned bits,
+                       unsigned words, unsigned pattern) {
+  for (unsigned i = 0; i < bits; i++)
+    sink_put_ch(s, '0' + pattern_bit(blocks, words, i, pattern));
+}
+
+/*------------------------------------------------------------------------*/
+
+uint64_t write_vectors(const simulation_model * sm, uint64_t seed,
+                       uint64_t count, unsigned threads,
+                       const std::vector<std::string> & names,
+                       std::vector<file_record> * records) {
+  unsigned width = sm->width, words = simulation_words(count);
+  uint64_t * values = allocate_words(simulation_variables(sm) * words);
+  const uint64_t * a = values + words, * b = values + (width + 1) * words;
+  std::vector<uint64_t> product(2 * width * words);
+  uint64_t state = seed;
+
+  std::vector<sink> sinks(names.size());
+  std::vector<bool> binary(names.size());
+  for (size_t j = 0; j < names.size(); j++) {
+    open_sink(&sinks[j], names[j].c_str());
+    sinks[j].hashed = records;
+    binary[j] = has_suffix(names[j].c_str(), ".vec");
+    if (!binary[j]) continue;
+    sink_put_s(&sinks[j], "maf-vectors ");
+    sink_put_u(&sinks[j], width);
+    sink_put_ch(&sinks[j], ' ');
+    sink_put_s(&sinks[j], std::to_string(count).c_str());
+    sink_put_ch(&sinks[j], '\n');
+  }
+
+  for (uint64_t first = 0; first < count; first += 64 * words) {
+    set_random_inputs(sm, words, &state, values);
+    simulate_model(sm, values, words, threads);
+    reference_product(width, a, b, &product[0], words);
+    unsigned pattern;
+    if (find_mismatch(sm, values, &product[0], words, &pattern))
+      report_counterexample(sm, values, &product[0], words, pattern);
+
+    unsigned patterns = std::min<uint64_t>(count - first, 64 * words);
+    for (size_t j = 0; j < sinks.size(); j++) {
+      sink * s = &sinks[j];
+      for (unsigned p = 0; p < patterns; p++) {
+        if (binary[j]) {
+          put_bytes(s, a, width, words, p);
+          put_bytes(s, b, width, words, p);
+          put_bytes(s, &product[0], 2 * width, words, p);
+        } else {
+          put_digits(s, a, width, words, p);
+          put_digits(s, b, width, words, p);
+          sink_put_ch(s, '\n');
+        }
+      }
+    }
+  }
+  free(values);
+
+  uint64_t res = 0;
+  for (size_t j = 0; j < sinks.size(); j++) {
+    res += sinks[j].bytes + (sinks[j].cursor - sinks[j].start);
+    if (records) {
+      finish_checksum(&sinks[j]);
+      file_record record;
+      record.name = sinks[j].name;
+      record.bytes = sinks[j].bytes;
+      record.checksum = sinks[j].checksum;
+      records->push_back(record);
+    }
+    close_sink(&sinks[j]);
+    msg(1, "  Printed %llu test vectors to: '%s'",
+      static_cast<unsigned long long>(count), sinks[j].name);
+  }
+  return res;
+}
+/*------------------------------------------------------------------------*/
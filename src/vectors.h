@@ -0,0 +1,61 @@
+/*------------------------------------------------------------------------*/
+/*! \file vectors.h
+    \brief contains the test vector files written with the instances
+
+  The vectors are random input patterns of the instance seed and their
+  products. They are simulated on the generated model and only written if
+  every output equals the product, hence they are known-good responses of
+  the instance. Two formats are selected by the suffix of the file name:
+
+  '.vec' is binary, the header line 'maf-vectors <width> <count>' is
+  followed by one record per vector, 'a', 'b' and the product in
+  little-endian byte order, 'ceil(n / 8)', 'ceil(n / 8)' and
+  'ceil(2n / 8)' bytes.
+
+  '.stim' is the stimulus file of aigsim, one line per vector with the
+  input bits in the order of the inputs a_0..a_{n-1}, b_0..b_{n-1}. The
+  products are only written to '.vec' files.
+
+  Part of MultAIGenFuzzer: Generation-Based AIG Fuzzer for Multipliers
+  Copyright(C) 2022 Daniela Kaufmann, Johannes Kepler University Linz
+*/
+/*------------------------------------------------------------------------*/
+#ifndef AIGENFUZZER_SRC_VECTORS_H_
+#define AIGENFUZZER_SRC_VECTORS_H_
+/*------------------------------------------------------------------------*/
+#include <string>
+#include <vector>
+
+#include "simulate.h"
+#include "writer.h"
+/*------------------------------------------------------------------------*/
+
+/**
+    Checks whether 'name' is a vector file, ending in '.vec' or '.stim'
+
+    @param name name of output file
+
+    @return bool
+*/
+bool is_vector_file(const char * name);
+
+/**
+    Simulates 'sm' on 'count' random patterns of 'seed', dies with a
+    counterexample if an output differs from the product, and writes the
+    vectors to the files 'names'
+
+    @param sm simulated model
+    @param seed seed of the patterns
+    @param count number of vectors
+    @param threads threads simulating the gates of a level
+    @param names vector files
+    @param records receives size and checksum of the files, or 0
+
+    @return number of bytes written
+*/
+uint64_t write_vectors(const simulation_model * sm, uint64_t seed,
+                       uint64_t count, unsigned threads,
+                       const std::vector<std::string> & names,
+                       std::vector<file_record> * records);
+
+#endif  // AIGENFUZZER_SRC_VECTORS_H_
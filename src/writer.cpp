@@ -0,0 +1,207 @@
+/*------------------------------------------------------------------------*/
+/*! \file writer.cpp
+    \brief contains buffered output sinks used to write the fuzzed AIG
+
+  Part of MultAIGenFuzzer: Generation-Based AIG Fuzzer for Multipliers
+  Copyright(C) 2022 Daniela Kaufmann, Johannes Kepler University Linz
+*/
+/*------------------------------------------------------------------------*/
+#include "writer.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+/*------------------------------------------------------------------------*/
+// Local Variables
+
+static const size_t sink_buffer_size = 1 << 20;
+static const size_t memory_sink_initial_size = 1 << 16;
+
+static unsigned writing_error = 21;
+
+// / Buffers of released file sinks, reused by the next sink
+static thread_local std::vector<char *> spare_buffers;
+/*------------------------------------------------------------------------*/
+
+bool has_suffix(const char * str, const char * suffix) {
+  size_t l = strlen(str), k = strlen(suffix);
+  return l >= k && !strcmp(str + l - k, suffix);
+}
+
+/*------------------------------------------------------------------------*/
+
+output_format output_format_of(const char * output_name) {
+  if (has_suffix(output_name, ".cnf")) return cnf_format;
+  if (has_suffix(output_name, ".aag")) return aag_format;
+  return aig_format;
+}
+
+/*------------------------------------------------------------------------*/
+
+uint64_t update_checksum(uint64_t checksum, const char * data, size_t size) {
+  const unsigned char * p = reinterpret_cast<const unsigned char *>(data);
+  for (size_t i = 0; i < size; i++) {
+    checksum ^= p[i];
+    checksum *= 0x100000001b3ull;
+  }
+  return checksum;
+}
+
+/*------------------------------------------------------------------------*/
+
+void init_sink(sink * s, FILE * file, const char * name,
+               output_format format) {
+  s->name = name;
+  s->format = format;
+  s->file = file;
+  s->hashed = 0;
+  s->bytes = 0;
+  s->checksum = initial_checksum;
+
+  if (spare_buffers.empty()) {
+    s->start = static_cast<char *>(malloc(sink_buffer_size));
+    if (!s->start) die(writing_error, "out of memory writing '%s'", name);
+  } else {
+    s->start = spare_buffers.back();
+    spare_buffers.pop_back();
+  }
+  s->cursor = s->start;
+  s->end = s->start + sink_buffer_size;
+}
+
+/*------------------------------------------------------------------------*/
+
+void init_memory_sink(sink * s, const char * name, output_format format) {
+  s->name = name;
+  s->format = format;
+  s->file = 0;
+  s->hashed = 0;
+  s->bytes = 0;
+  s->checksum = initial_checksum;
+
+  s->start = static_cast<char *>(malloc(memory_sink_initial_size));
+  if (!s->start) die(writing_error, "out of memory writing '%s'", name);
+  s->cursor = s->start;
+  s->end = s->start + memory_sink_initial_size;
+}
+
+/*------------------------------------------------------------------------*/
+
+void open_sink(sink * s, const char * name) {
+  FILE * file;
+  if (!(file = fopen(name, "w")))
+    die(writing_error, "can not write output to '%s'", name);
+  init_sink(s, file, name, output_format_of(name));
+}
+
+/*------------------------------------------------------------------------*/
+
+void flush_sink(sink * s) {
+  size_t bytes = s->cursor - s->start;
+  if (!s->file) {  // memory sink, only grow when full
+    if (s->cursor < s->end) return;
+    size_t size = 2 * bytes;
+    char * start = static_cast<char *>(realloc(s->start, size));
+    if (!start) die(writing_error, "out of memory writing '%s'", s->name);
+    s->start = start;
+    s->cursor = start + bytes;
+    s->end = start + size;
+    return;
+  }
+
+  if (bytes && fwrite(s->start, 1, bytes, s->file) != bytes)
+    die(writing_error, "failed to write output to '%s'", s->name);
+  if (s->hashed) s->checksum = update_checksum(s->checksum, s->start, bytes);
+  s->bytes += bytes;
+  s->cursor = s->start;
+}
+
+/*------------------------------------------------------------------------*/
+
+void finish_checksum(sink * s) {
+  if (s->file) {
+    assert(s->hashed);
+    flush_sink(s);
+  } else {
+    s->bytes = s->cursor - s->start;
+    s->checksum = update_checksum(initial_checksum, s->start, s->bytes);
+  }
+}
+
+/*------------------------------------------------------------------------*/
+
+void release_sink(sink * s) {
+  if (s->file) {
+    flush_sink(s);
+    spare_buffers.push_back(s->start);
+  } else {
+    free(s->start);
+  }
+  s->start = s->cursor = s->end = 0;
+}
+
+/*------------------------------------------------------------------------*/
+
+void reset_sink_buffers() {
+  for (size_t i = 0; i < spare_buffers.size(); i++) free(spare_buffers[i]);
+  spare_buffers.clear();
+}
+
+/*------------------------------------------------------------------------*/
+
+char * take_sink_buffer(sink * s, size_t * size) {
+  assert(!s->file);
+  char * res = s->start;
+  *size = s->cursor - s->start;
+  s->start = s->cursor = s->end = 0;
+  return res;
+}
+
+/*------------------------------------------------------------------------*/
+
+void close_sink(sink * s) {
+  release_sink(s);
+  if (fclose(s->file))
+    die(writing_error, "failed to close '%s'", s->name);
+  s->file = 0;
+}
+
+/*------------------------------------------------------------------------*/
+
+void sink_put_u(sink * s, unsigned u) {
+  char buffer[sizeof(u) * 3];
+  char * p = buffer + sizeof buffer;
+  do {
+    *--p = '0' + u % 10;
+    u /= 10;
+  } while (u);
+  while (p < buffer + sizeof buffer) sink_put_ch(s, *p++);
+}
+
+/*------------------------------------------------------------------------*/
+
+void sink_put_i(sink * s, int i) {
+  if (i < 0) {
+    sink_put_ch(s, '-');
+    sink_put_u(s, -static_cast<unsigned>(i));
+  } else {
+    sink_put_u(s, i);
+  }
+}
+
+/*------------------------------------------------------------------------*/
+
+void sink_put_s(sink * s, const char * str) {
+  while (*str) sink_put_ch(s, *str++);
+}
+
+/*------------------------------------------------------------------------*/
+
+void sink_put_delta(sink * s, unsigned delta) {
+  while (delta & ~0x7f) {
+    sink_put_ch(s, (delta & 0x7f) | 0x80);
+    delta >>= 7;
+  }
+  sink_put_ch(s, delta);
+}
+/*------------------------------------------------------------------------*/
@@ -0,0 +1,180 @@
+/*------------------------------------------------------------------------*/
+/*! \file writer.h
+    \brief contains buffered output sinks used to write the fuzzed AIG
+
+  Part of MultAIGenFuzzer: Generation-Based AIG Fuzzer for Multipliers
+  Copyright(C) 2022 Daniela Kaufmann, Johannes Kepler University Linz
+*/
+/*------------------------------------------------------------------------*/
+#ifndef AIGENFUZZER_SRC_WRITER_H_
+#define AIGENFUZZER_SRC_WRITER_H_
+/*------------------------------------------------------------------------*/
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "signal_statistics.h"
+/*------------------------------------------------------------------------*/
+
+/**
+    Output formats, selected by the suffix of the output file name
+*/
+enum output_format {
+  aig_format,  // /< binary AIGER (default)
+  aag_format,  // /< ASCII AIGER, suffix '.aag'
+  cnf_format   // /< DIMACS CNF, suffix '.cnf'
+};
+
+/**
+    Checks whether 'str' ends in 'suffix'
+
+    @return bool
+*/
+bool has_suffix(const char * str, const char * suffix);
+
+/**
+    Determines the output format from the suffix of the file name
+
+    @param output_name name of output file
+
+    @return output_format
+*/
+output_format output_format_of(const char * output_name);
+/*------------------------------------------------------------------------*/
+
+/**
+    Buffered byte sink for one output target. Bytes are collected in
+    the buffer ['start', 'end') and handed to 'file' in large blocks.
+    Memory sinks have no file, their buffer grows until it is taken.
+*/
+struct sink {
+  const char * name;       // /< name of output file
+  output_format format;    // /< format written to this sink
+  FILE * file;             // /< output file
+  char * start;            // /< start of buffer
+  char * cursor;           // /< next free byte in buffer
+  char * end;              // /< end of buffer
+  bool hashed;             // /< checksum of file sinks is updated on flush
+  uint64_t bytes;          // /< bytes covered by 'checksum'
+  uint64_t checksum;       // /< checksum of the written bytes
+};
+
+/**
+    Size and checksum of a written file, recorded in manifests
+*/
+struct file_record {
+  const char * name;       // /< name of output file
+  uint64_t bytes;          // /< size of the file
+  uint64_t checksum;       // /< 'update_checksum' of its content
+};
+
+// / Checksum of no bytes
+static const uint64_t initial_checksum = 0xcbf29ce484222325ull;
+
+/**
+    Updates the 64-bit FNV-1a checksum 'checksum' by 'size' bytes at 'data'
+
+    @return uint64_t
+*/
+uint64_t update_checksum(uint64_t checksum, const char * data, size_t size);
+
+/**
+    Attaches 's' to the already opened 'file' and allocates its buffer
+
+    @param s sink
+    @param file output file
+    @param name name of output file, used in error messages
+    @param format format written to this sink
+*/
+void init_sink(sink * s, FILE * file, const char * name,
+               output_format format);
+
+/**
+    Initializes 's' as memory sink, which keeps all bytes in its buffer
+
+    @param s sink
+    @param name name of output file, used in error messages
+    @param format format written to this sink
+*/
+void init_memory_sink(sink * s, const char * name, output_format format);
+
+/**
+    Opens the output file 'name' and allocates the buffer of 's'.
+    Dies if the file can not be opened.
+
+    @param s sink
+    @param name name of output file
+*/
+void open_sink(sink * s, const char * name);
+
+/**
+    Writes the buffered bytes of 's' to its file
+
+    @param s sink
+*/
+void flush_sink(sink * s);
+
+/**
+    Completes the checksum of 's'. A file sink, which needs 'hashed' set
+    before the first flush, is flushed, a memory sink is hashed at once.
+*/
+void finish_checksum(sink * s);
+
+/**
+    Flushes 's' and releases the buffer, but keeps its file open.
+    The buffer of a file sink is kept for the next sink.
+
+    @param s sink
+*/
+void release_sink(sink * s);
+
+/**
+    Deallocates the buffers kept by 'release_sink' in the calling thread
+*/
+void reset_sink_buffers();
+
+/**
+    Takes the buffer of the memory sink 's', which has to be released
+    with 'free' by the caller
+
+    @param s memory sink
+    @param size set to the number of bytes in the buffer
+
+    @return buffer
+*/
+char * take_sink_buffer(sink * s, size_t * size);
+
+/**
+    Flushes 's', closes its file and releases the buffer
+
+    @param s sink
+*/
+void close_sink(sink * s);
+/*------------------------------------------------------------------------*/
+
+inline void sink_put_ch(sink * s, char ch) {
+  if (s->cursor == s->end) flush_sink(s);
+  *s->cursor++ = ch;
+}
+
+/**
+    Writes the decimal representation of 'u' to 's'
+*/
+void sink_put_u(sink * s, unsigned u);
+
+/**
+    Writes the decimal representation of 'i' to 's'
+*/
+void sink_put_i(sink * s, int i);
+
+/**
+    Writes the zero terminated string 'str' to 's'
+*/
+void sink_put_s(sink * s, const char * str);
+
+/**
+    Writes 'delta' in the 7-bit variable length encoding of binary AIGER
+*/
+void sink_put_delta(sink * s, unsigned delta);
+
+#endif  // AIGENFUZZER_SRC_WRITER_H_
@@ -0,0 +1,53 @@
+#!/bin/sh
+# Appending to an archive must keep its entries if the run is stopped and
+# must not rewrite them.
+die () {
+  echo "*** archive_append.sh: $*" 1>&2
+  exit 1
+}
+maf=`pwd`/multaigenfuzzer
+[ -x "$maf" ] || die "run 'make' first"
+tmp=/tmp/maf-archive-append-$$
+trap "rm -rf $tmp" 0
+mkdir $tmp || exit 1
+cd $tmp
+
+entries () {
+  $maf --list c3.arch 2>&1 | sed -n 's/^\[maf\]  *\([0-9]*\) entries$/\1/p'
+}
+
+$maf -i 8 -n 3 -s 1 --archive c3.arch >/dev/null 2>&1 ||
+  die "creating archive failed"
+[ "`entries`" = 3 ] || die "archive has not 3 entries"
+cp c3.arch old.arch
+$maf --list c3.arch >list.txt 2>&1
+seed=`sed -n 's/^\[maf\]  *8  *\([0-9]*\) .*/\1/p' list.txt | head -1`
+$maf -i 8 -s $seed --extract c3.arch first.aig >/dev/null 2>&1 ||
+  die "extracting first entry failed"
+
+# dies on the missing directory 'd10'
+$maf -i 9..10 -s 5 --archive c3.arch 'd%w/x%s.aig' >/dev/null 2>&1 &&
+  die "writing to missing directory succeeded"
+[ "`entries`" = 3 ] || die "archive lost its entries after 'die'"
+
+# killed while appending
+$maf -i 64 -n 1000000 -s 7 --archive c3.arch >/dev/null 2>&1 &
+pid=$!
+sleep 1
+kill -9 $pid
+wait $pid 2>/dev/null
+[ "`entries`" = 3 ] || die "archive lost its entries after 'kill'"
+$maf -i 8 -s $seed --extract c3.arch again.aig >/dev/null 2>&1 ||
+  die "extracting first entry after 'kill' failed"
+cmp -s first.aig again.aig || die "first entry changed after 'kill'"
+
+# the next run drops the bytes of the killed run and appends
+mkdir d9 d10
+$maf -i 9..10 -s 5 --archive c3.arch 'd%w/x%s.aig' >/dev/null 2>&1 ||
+  die "appending failed"
+[ "`entries`" = 5 ] || die "archive has not 5 entries after appending"
+cmp -s -n `wc -c <old.arch` old.arch c3.arch ||
+  die "appending changed the old data"
+[ `wc -c <c3.arch` -lt 100000 ] ||
+  die "bytes of the killed run were not dropped"
+exit 0
@@ -0,0 +1,31 @@
+#!/bin/sh
+# A stopped batch must append every instance listed in its manifest.
+die () {
+  echo "*** archive_stop.sh: $*" 1>&2
+  exit 1
+}
+maf=`pwd`/multaigenfuzzer
+[ -x "$maf" ] || die "run 'make' first"
+tmp=/tmp/maf-archive-stop-$$
+trap "rm -rf $tmp" 0
+mkdir $tmp || exit 1
+cd $tmp
+
+entries () {
+  $maf --list a.arch 2>&1 | sed -n 's/^\[maf\]  *\([0-9]*\) entries$/\1/p'
+}
+batch="-i 4..60:4 -n 60 -s 5 --archive a.arch --manifest m.txt -j 8"
+
+$maf $batch >/dev/null 2>&1 &
+pid=$!
+sleep 3
+kill -TERM $pid
+wait $pid 2>/dev/null
+listed=`grep -c a.arch m.txt`
+[ "`entries`" = "$listed" ] ||
+  die "archive has `entries` entries, manifest lists $listed"
+
+$maf $batch --resume >/dev/null 2>&1 || die "resuming failed"
+[ "`entries`" = 900 ] || die "archive has `entries` entries after resume"
+[ "`grep -c a.arch m.txt`" = 900 ] || die "manifest incomplete after resume"
+exit 0
@@ -0,0 +1,41 @@
+#!/bin/sh
+# Instances written to the same bytes must get the same fingerprint.
+die () {
+  echo "*** fingerprint_dedup.sh: $*" 1>&2
+  exit 1
+}
+maf=`pwd`/multaigenfuzzer
+[ -x "$maf" ] || die "run 'make' first"
+tmp=/tmp/maf-fingerprint-dedup-$$
+trap "rm -rf $tmp" 0
+mkdir $tmp || exit 1
+cd $tmp
+
+# seeds 621380812 and 823427460 of this batch give the same file
+$maf -i 3 -n 200 -s 9 'p_%s.aig' --manifest m.txt >/dev/null 2>&1 ||
+  die "generating batch failed"
+cmp -s p_621380812.aig p_823427460.aig ||
+  die "instances 621380812 and 823427460 differ"
+fingerprint () {
+  sed -n "s/^3 $1 .* \([0-9a-f]*\) p_$1.aig$/\1/p" m.txt
+}
+first=`fingerprint 621380812`
+[ -n "$first" ] || die "no fingerprint in manifest"
+[ "$first" = "`fingerprint 823427460`" ] ||
+  die "equal instances have different fingerprints"
+
+mkdir d
+$maf -i 3 -n 200 -s 9 'd/p_%s.aig' --dedup >/dev/null 2>&1 ||
+  die "generating batch with '--dedup' failed"
+[ ! -f d/p_823427460.aig ] || die "'--dedup' kept the duplicate"
+
+# the earlier job of the schedule wins for any number of threads
+for j in 1 8
+do
+  mkdir j$j
+  $maf -i 3 -n 400 -s 9 "j$j/p_%s.aig" --dedup -j $j >/dev/null 2>&1 ||
+    die "generating batch with '-j $j' failed"
+  ls j$j >j$j.txt
+done
+cmp -s j1.txt j8.txt || die "'--dedup' writes other instances with '-j 8'"
+exit 0
@@ -0,0 +1,24 @@
+#!/bin/sh
+# Adding an output file must not change the other output files.
+die () {
+  echo "*** output_targets.sh: $*" 1>&2
+  exit 1
+}
+maf=`pwd`/multaigenfuzzer
+[ -x "$maf" ] || die "run 'make' first"
+tmp=/tmp/maf-output-targets-$$
+trap "rm -rf $tmp" 0
+mkdir $tmp || exit 1
+cd $tmp
+
+for r in "" -r; do
+  $maf -i 16 -s 4 $r a.aag >/dev/null 2>&1 || die "writing a.aag failed"
+  $maf -i 16 -s 4 $r b.cnf >/dev/null 2>&1 || die "writing b.cnf failed"
+  $maf -i 16 -s 4 $r c.aig >/dev/null 2>&1 || die "writing c.aig failed"
+  $maf -i 16 -s 4 $r x.aag x.aig x.cnf >/dev/null 2>&1 ||
+    die "writing all formats failed"
+  cmp -s a.aag x.aag || die "ASCII AIGER depends on the other targets $r"
+  cmp -s b.cnf x.cnf || die "CNF depends on the other targets $r"
+  cmp -s c.aig x.aig || die "binary AIGER depends on the other targets $r"
+done
+exit 0